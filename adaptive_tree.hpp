@@ -0,0 +1,494 @@
+#ifndef ADAPTIVE_TREE_HPP
+#define ADAPTIVE_TREE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stdexcept> // Per std::runtime_error
+#include "binarytree.hpp"
+#include "frozen_tree.hpp"
+
+/**
+ * @brief Insieme ordinato che sceglie la propria rappresentazione in base al carico.
+ *
+ * Le rappresentazioni possibili sono:
+ * - @c INLINE: array ordinato di al più @p InlineCapacity elementi dentro
+ *   l'oggetto stesso, senza allocazioni;
+ * - @c POINTER: un BinaryTree mutabile, adatto alle fasi di costruzione e
+ *   aggiornamento;
+ * - @c FROZEN: un FrozenBinaryTree contiguo per le fasi di sola lettura. Gli
+ *   inserimenti occasionali finiscono in un piccolo BinaryTree delta che
+ *   viene fuso nell'istantanea quando supera una frazione della sua dimensione.
+ *
+ * Le operazioni vengono contate per finestre di @c window operazioni; alla
+ * fine di ogni finestra si valuta la frazione di scritture. Il passaggio da
+ * POINTER a FROZEN richiede @c freeze_windows finestre consecutive sotto
+ * @c freeze_ratio, mentre il ritorno a POINTER richiede una finestra sopra
+ * @c thaw_ratio: le due soglie distinte evitano conversioni ripetute quando il
+ * carico oscilla attorno a un unico valore. Congelare costa O(size()), quindi
+ * richiede anche almeno size() operazioni dall'ultima conversione: un ciclo
+ * congela/scongela costa così O(1) ammortizzato per operazione.
+ *
+ * Quando INLINE si riempie, l'insieme passa a FROZEN se le ultime
+ * freeze_windows finestre erano già sotto freeze_ratio, altrimenti a POINTER.
+ * Non si torna mai a INLINE: l'insieme non ha rimozioni, quindi una volta
+ * superata InlineCapacity la dimensione non può più rientrarci.
+ *
+ * @tparam T Tipo dei dati contenuti.
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @tparam InlineCapacity Numero massimo di elementi nella rappresentazione INLINE.
+ */
+template<typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T>, size_t InlineCapacity = 16>
+class AdaptiveBinaryTree {
+public:
+    /**
+     * @brief Rappresentazione corrente.
+     */
+    enum representation {
+        INLINE,  ///< Array ordinato interno all'oggetto.
+        POINTER, ///< BinaryTree mutabile.
+        FROZEN   ///< FrozenBinaryTree con delta di inserimenti.
+    };
+
+    static const size_t window = 4096; ///< Operazioni per finestra di osservazione.
+    static const size_t freeze_windows = 2; ///< Finestre consecutive in lettura prima di congelare.
+
+private:
+    typedef BinaryTree<T, Compare, Equal> Tree;
+    typedef FrozenBinaryTree<T, Compare, Equal> Frozen;
+
+    static constexpr double freeze_ratio = 0.01; ///< Frazione di scritture sotto cui si congela.
+    static constexpr double thaw_ratio = 0.10; ///< Frazione di scritture sopra cui si scongela.
+    static const size_t delta_divisor = 16; ///< Il delta viene fuso oltre size()/delta_divisor elementi.
+
+    alignas(T) unsigned char inline_storage[InlineCapacity * sizeof(T)]; ///< Elementi INLINE.
+    size_t inline_count; ///< Elementi costruiti in inline_storage.
+    Tree tree; ///< Elementi POINTER.
+    Frozen frozen; ///< Elementi FROZEN.
+    Tree delta; ///< Inserimenti ricevuti in FROZEN non ancora fusi.
+    representation mode; ///< Rappresentazione corrente.
+    Compare compare; ///< Functore per confrontare i dati.
+    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
+
+    size_t window_reads; ///< Letture nella finestra corrente.
+    size_t window_writes; ///< Scritture nella finestra corrente.
+    size_t quiet_windows; ///< Finestre consecutive sotto freeze_ratio.
+    size_t conversions; ///< Cambi di rappresentazione effettuati.
+    size_t merges; ///< Fusioni del delta in FROZEN, che non cambiano rappresentazione.
+    size_t converted_ops; ///< Operazioni dall'ultima conversione decisa dalla politica.
+
+    T* inline_data() {
+        return reinterpret_cast<T*>(inline_storage);
+    }
+
+    const T* inline_data() const {
+        return reinterpret_cast<const T*>(inline_storage);
+    }
+
+    /**
+     * @brief Distrugge gli elementi INLINE.
+     */
+    void clear_inline() {
+        for (size_t i = 0; i < inline_count; ++i) {
+            inline_data()[i].~T();
+        }
+        inline_count = 0;
+    }
+
+    /**
+     * @brief Sposta gli elementi INLINE di other in questo insieme (che non ne ha).
+     */
+    void take_inline(AdaptiveBinaryTree& other) {
+        for (; inline_count < other.inline_count; ++inline_count) {
+            new (inline_data() + inline_count) T(std::move(other.inline_data()[inline_count]));
+        }
+        other.clear_inline();
+    }
+
+    /**
+     * @brief Riporta l'insieme vuoto in INLINE, come appena costruito.
+     */
+    void reset() {
+        clear_inline();
+        tree = Tree(compare, equal);
+        frozen = Frozen(compare, equal);
+        delta = Tree(compare, equal);
+        mode = INLINE;
+        window_reads = 0;
+        window_writes = 0;
+        quiet_windows = 0;
+        conversions = 0;
+        merges = 0;
+        converted_ops = 0;
+    }
+
+    /**
+     * @brief Posizione del primo elemento INLINE non minore di value.
+     */
+    size_t inline_lower_bound(const T& value) const {
+        size_t pos = 0;
+        while (pos < inline_count && !equal(inline_data()[pos], value) && compare(inline_data()[pos], value)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    /**
+     * @brief Copia in un vettore tutti gli elementi in ordine.
+     */
+    std::vector<T> sorted_values() const {
+        std::vector<T> values;
+        values.reserve(size());
+        for_each([&values](const T& value) { values.push_back(value); });
+        return values;
+    }
+
+    /**
+     * @brief Converte la rappresentazione corrente in POINTER.
+     */
+    void to_pointer() {
+        std::vector<T> values = sorted_values();
+        tree = Tree::bulk_build(values.begin(), values.end(), compare, equal);
+        clear_inline();
+        frozen = Frozen(compare, equal);
+        delta = Tree(compare, equal);
+        mode = POINTER;
+        conversions++;
+    }
+
+    /**
+     * @brief Converte la rappresentazione corrente (o fonde il delta) in FROZEN.
+     *
+     * Una fusione del delta, già in FROZEN, è contata in merges e non in conversions.
+     */
+    void to_frozen() {
+        frozen = Frozen(sorted_values(), compare, equal);
+        clear_inline();
+        tree = Tree(compare, equal);
+        delta = Tree(compare, equal);
+        if (mode == FROZEN) {
+            merges++;
+        } else {
+            conversions++;
+        }
+        mode = FROZEN;
+    }
+
+    /**
+     * @brief Registra un'operazione e, a fine finestra, applica la politica di conversione.
+     *
+     * @param write true se l'operazione è una scrittura.
+     */
+    void record(bool write) {
+        if (write) {
+            window_writes++;
+        } else {
+            window_reads++;
+        }
+        converted_ops++;
+        if (window_reads + window_writes < window) {
+            return;
+        }
+        double ratio = static_cast<double>(window_writes) / static_cast<double>(window_reads + window_writes);
+        window_reads = 0;
+        window_writes = 0;
+        if (mode == FROZEN) {
+            if (ratio > thaw_ratio) {
+                to_pointer();
+                converted_ops = 0;
+            }
+            return;
+        }
+        // In INLINE le finestre vengono solo contate: decidono la rappresentazione al riempimento.
+        quiet_windows = ratio < freeze_ratio ? quiet_windows + 1 : 0;
+        if (mode == POINTER && quiet_windows >= freeze_windows && converted_ops >= size()) {
+            quiet_windows = 0;
+            to_frozen();
+            converted_ops = 0;
+        }
+    }
+
+public:
+    /**
+     * @brief Costruisce un insieme vuoto in rappresentazione INLINE.
+     *
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    explicit AdaptiveBinaryTree(Compare comp = Compare(), Equal eq = Equal())
+        : inline_count(0), tree(comp, eq), frozen(comp, eq), delta(comp, eq), mode(INLINE), compare(comp), equal(eq),
+          window_reads(0), window_writes(0), quiet_windows(0), conversions(0), merges(0), converted_ops(0) {}
+
+    /**
+     * @brief Costruisce l'insieme da una sequenza, in rappresentazione POINTER bilanciata.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * @throw std::runtime_error Se la sequenza contiene duplicati.
+     */
+    template<typename InputIt>
+    AdaptiveBinaryTree(InputIt first, InputIt last, Compare comp = Compare(), Equal eq = Equal())
+        : inline_count(0), tree(Tree::bulk_build(first, last, comp, eq)), frozen(comp, eq), delta(comp, eq),
+          mode(POINTER), compare(comp), equal(eq), window_reads(0), window_writes(0), quiet_windows(0), conversions(0),
+          merges(0), converted_ops(0) {}
+
+    AdaptiveBinaryTree(const AdaptiveBinaryTree&) = delete;
+    AdaptiveBinaryTree& operator=(const AdaptiveBinaryTree&) = delete;
+
+    /**
+     * @brief Costruttore di spostamento.
+     *
+     * Acquisisce rappresentazione e statistiche; gli elementi INLINE vengono
+     * spostati uno per uno. other resta un insieme vuoto in INLINE.
+     *
+     * @param other Insieme da cui spostare gli elementi.
+     */
+    AdaptiveBinaryTree(AdaptiveBinaryTree&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : inline_count(0), tree(std::move(other.tree)), frozen(std::move(other.frozen)), delta(std::move(other.delta)),
+          mode(other.mode), compare(other.compare), equal(other.equal), window_reads(other.window_reads),
+          window_writes(other.window_writes), quiet_windows(other.quiet_windows), conversions(other.conversions),
+          merges(other.merges), converted_ops(other.converted_ops) {
+        take_inline(other);
+        other.reset();
+    }
+
+    /**
+     * @brief Operatore di assegnazione per spostamento.
+     *
+     * @param other Insieme da cui spostare gli elementi (resta vuoto in INLINE).
+     * @return AdaptiveBinaryTree& Referenza a se stesso dopo l'assegnazione.
+     */
+    AdaptiveBinaryTree& operator=(AdaptiveBinaryTree&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            clear_inline();
+            take_inline(other);
+            tree = std::move(other.tree);
+            frozen = std::move(other.frozen);
+            delta = std::move(other.delta);
+            mode = other.mode;
+            compare = other.compare;
+            equal = other.equal;
+            window_reads = other.window_reads;
+            window_writes = other.window_writes;
+            quiet_windows = other.quiet_windows;
+            conversions = other.conversions;
+            merges = other.merges;
+            converted_ops = other.converted_ops;
+            other.reset();
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore che libera gli elementi INLINE.
+     */
+    ~AdaptiveBinaryTree() {
+        clear_inline();
+    }
+
+    /**
+     * @brief Inserisce un nuovo valore.
+     *
+     * @param value Valore da inserire.
+     * @throw std::runtime_error Se il valore duplicato viene inserito.
+     */
+    void insert(const T& value) {
+        BINARYTREE_TRY {
+            TreeError err = try_insert(value);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Inserisce un nuovo valore riportando l'esito con un codice.
+     *
+     * Le conversioni di rappresentazione allocano vettori della libreria
+     * standard e restano soggette al suo trattamento degli errori.
+     *
+     * @param value Valore da inserire.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
+     */
+    TreeError try_insert(const T& value) {
+        TreeError err = TreeError::none;
+        switch (mode) {
+        case INLINE: {
+            size_t pos = inline_lower_bound(value);
+            if (pos < inline_count && equal(inline_data()[pos], value)) {
+                return TreeError::duplicate;
+            }
+            if (inline_count == InlineCapacity) {
+                if (quiet_windows >= freeze_windows) {
+                    quiet_windows = 0;
+                    to_frozen();
+                    err = delta.try_insert(value);
+                } else {
+                    to_pointer();
+                    err = tree.try_insert(value);
+                }
+                converted_ops = 0;
+                break;
+            }
+            if (pos == inline_count) {
+                new (inline_data() + inline_count) T(value);
+            } else {
+                new (inline_data() + inline_count) T(inline_data()[inline_count - 1]);
+                std::copy_backward(inline_data() + pos, inline_data() + inline_count - 1, inline_data() + inline_count);
+                inline_data()[pos] = value;
+            }
+            inline_count++;
+            break;
+        }
+        case POINTER:
+            err = tree.try_insert(value);
+            break;
+        case FROZEN:
+            if (frozen.exists(value)) {
+                return TreeError::duplicate;
+            }
+            err = delta.try_insert(value);
+            if (err == TreeError::none && delta.size() > frozen.size() / delta_divisor) {
+                to_frozen();
+            }
+            break;
+        }
+        if (err == TreeError::none) {
+            record(true);
+        }
+        return err;
+    }
+
+    /**
+     * @brief Verifica se un valore esiste.
+     *
+     * Non è const perché alimenta le statistiche che guidano le conversioni.
+     *
+     * @param value Valore da cercare.
+     * @return true Se il valore esiste.
+     * @return false Altrimenti.
+     */
+    bool exists(const T& value) {
+        bool found = false;
+        switch (mode) {
+        case INLINE: {
+            size_t pos = inline_lower_bound(value);
+            found = pos < inline_count && equal(inline_data()[pos], value);
+            break;
+        }
+        case POINTER:
+            found = tree.exists(value);
+            break;
+        case FROZEN:
+            found = frozen.exists(value) || (delta.size() != 0 && delta.exists(value));
+            break;
+        }
+        record(false);
+        return found;
+    }
+
+    /**
+     * @brief Applica una funzione a tutti gli elementi, in ordine.
+     *
+     * @tparam Function Tipo della funzione, invocata con const T&.
+     * @param f Funzione da applicare.
+     */
+    template<typename Function>
+    void for_each(Function f) const {
+        switch (mode) {
+        case INLINE:
+            for (size_t i = 0; i < inline_count; ++i) {
+                f(inline_data()[i]);
+            }
+            break;
+        case POINTER:
+            for (typename Tree::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+                f(*it);
+            }
+            break;
+        case FROZEN: {
+            typename Frozen::const_iterator a = frozen.begin();
+            typename Tree::const_iterator b = delta.begin();
+            while (a != frozen.end() || b != delta.end()) {
+                if (b == delta.end() || (a != frozen.end() && compare(*a, *b))) {
+                    f(*a);
+                    ++a;
+                } else {
+                    f(*b);
+                    ++b;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    /**
+     * @brief Restituisce il numero di elementi.
+     *
+     * @return size_t Numero di elementi.
+     */
+    size_t size() const {
+        switch (mode) {
+        case INLINE:
+            return inline_count;
+        case POINTER:
+            return tree.size();
+        default:
+            return frozen.size() + delta.size();
+        }
+    }
+
+    /**
+     * @brief Restituisce la rappresentazione corrente.
+     *
+     * @return representation Rappresentazione in uso.
+     */
+    representation current_representation() const {
+        return mode;
+    }
+
+    /**
+     * @brief Restituisce il numero di cambi di rappresentazione effettuati.
+     *
+     * Le fusioni del delta in FROZEN non sono conversioni: vedi merge_count().
+     *
+     * @return size_t Numero di conversioni.
+     */
+    size_t conversion_count() const {
+        return conversions;
+    }
+
+    /**
+     * @brief Restituisce il numero di fusioni del delta nella rappresentazione FROZEN.
+     *
+     * @return size_t Numero di fusioni.
+     */
+    size_t merge_count() const {
+        return merges;
+    }
+
+    /**
+     * @brief Stampa gli elementi in ordine.
+     *
+     * @param os Stream di output su cui stampare.
+     * @param tree Insieme da stampare.
+     * @return std::ostream& Stream di output aggiornato.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const AdaptiveBinaryTree& tree) {
+        tree.for_each([&os](const T& value) { os << value << " "; });
+        return os;
+    }
+};
+
+#endif // ADAPTIVE_TREE_HPP
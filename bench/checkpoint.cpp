@@ -0,0 +1,89 @@
+/**
+ * @file checkpoint.cpp
+ * @brief Costo di checkpoint incrementali rispetto a istantanee complete.
+ *
+ * Costruisce un BinaryTree<int> con chiavi casuali e ne scrive un
+ * checkpoint completo; poi, per alcuni round, inserisce una piccola
+ * percentuale di nuove chiavi e confronta tempo e byte scritti da checkpoint e da save_snapshot. Alla
+ * fine verifica che restore_checkpoint ricostruisca lo stesso albero.
+ *
+ * Uso: bench_checkpoint.exe [n] [percentuale modificata] [directory]
+ */
+
+#define BINARYTREE_CHECKPOINTS
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include "binarytree.hpp"
+#include "tree_snapshot.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Somma le dimensioni dei file di una directory.
+ *
+ * @param dir Directory da misurare.
+ * @return uintmax_t Byte occupati dai file.
+ */
+static uintmax_t directory_bytes(const std::string& dir) {
+    uintmax_t bytes = 0;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file()) {
+            bytes += entry.file_size();
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief Funzione principale del benchmark.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    double percent = argc > 2 ? std::strtod(argv[2], nullptr) : 2.0;
+    std::string dir = argc > 3 ? argv[3] : "bench_checkpoint.dir";
+    std::string snapshot = dir + ".snap";
+    std::filesystem::remove_all(dir);
+
+    BinaryTree<int> tree;
+    std::mt19937 rng(7);
+    while (tree.size() < n) {
+        tree.try_insert(static_cast<int>(rng() >> 2) * 2);
+    }
+    Clock::time_point t0 = Clock::now();
+    tree.checkpoint(dir);
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << "Tree with " << n << " nodes, full checkpoint: " << secs * 1e3 << " ms, "
+              << directory_bytes(dir) / 1024 << " KiB" << std::endl;
+
+    size_t changes = static_cast<size_t>(n * percent / 100);
+    for (int round = 1; round <= 3; ++round) {
+        for (size_t i = 0; i < changes; ++i) {
+            tree.try_insert(static_cast<int>(rng() >> 2) * 2 + 1);
+        }
+        uintmax_t before = directory_bytes(dir);
+        t0 = Clock::now();
+        tree.checkpoint(dir);
+        double incremental = std::chrono::duration<double>(Clock::now() - t0).count();
+        uintmax_t written = directory_bytes(dir) - before;
+        t0 = Clock::now();
+        save_snapshot(tree, snapshot);
+        double full = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "round " << round << " (+" << changes << " keys): checkpoint " << incremental * 1e3 << " ms, "
+                  << written / 1024 << " KiB; save_snapshot " << full * 1e3 << " ms, "
+                  << std::filesystem::file_size(snapshot) / 1024 << " KiB" << std::endl;
+    }
+
+    t0 = Clock::now();
+    BinaryTree<int> restored = BinaryTree<int>::restore_checkpoint(dir);
+    secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    bool same = restored.size() == tree.size() && std::equal(restored.begin(), restored.end(), tree.begin());
+    std::cout << "restore_checkpoint: " << secs * 1e3 << " ms, " << (same ? "identical" : "MISMATCH") << std::endl;
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove(snapshot);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file filter.cpp
+ * @brief Throughput del filtro vettorizzato su istantanee congelate.
+ *
+ * Confronta, sulle stesse chiavi, il filtro elemento per elemento tramite
+ * iteratore (come printIF) con FrozenBinaryTree::filter_simd, per un
+ * predicato di parità (scansione completa) e uno di parità su intervallo.
+ * Il throughput è espresso in GB/s di chiavi lette.
+ *
+ * Uso: bench_filter.exe [n]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "binarytree.hpp"
+#include "frozen_tree.hpp"
+#include "test_types.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Misura il throughput migliore su più ripetizioni.
+ *
+ * @param bytes Byte letti da ogni chiamata di f.
+ * @param f Funzione da misurare; restituisce il numero di chiavi selezionate.
+ * @param selected Numero di chiavi selezionate dall'ultima chiamata.
+ * @return double GB/s.
+ */
+template<typename F>
+static double measure(size_t bytes, F f, size_t& selected) {
+    double best = 0;
+    for (int r = 0; r < 5; ++r) {
+        Clock::time_point t0 = Clock::now();
+        selected = f();
+        double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+        best = std::max(best, bytes / secs / 1e9);
+    }
+    return best;
+}
+
+/**
+ * @brief Funzione principale del benchmark.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = static_cast<int>(3 * i);
+    }
+    BinaryTree<int> tree = BinaryTree<int>::bulk_build(keys.begin(), keys.end());
+    FrozenBinaryTree<int> frozen(tree);
+    std::vector<int> out(n);
+    size_t bytes = n * sizeof(int);
+    int lo = static_cast<int>(n / 2);
+    int hi = static_cast<int>(2 * n);
+    IsEven<int> even;
+    KeyFilter<int> simdEven = KeyFilter<int>().even();
+    KeyFilter<int> simdRange = KeyFilter<int>().even().between(lo, hi);
+    size_t selected = 0;
+
+    std::cout << "Frozen tree with " << n << " int keys" << std::endl;
+    double gbs = measure(bytes, [&]() {
+        size_t count = 0;
+        for (BinaryTree<int>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            if (even(*it)) {
+                out[count++] = *it;
+            }
+        }
+        return count;
+    }, selected);
+    std::cout << "even, iterator             " << gbs << " GB/s (" << selected << " keys)" << std::endl;
+    gbs = measure(bytes, [&]() {
+        size_t count = 0;
+        for (FrozenBinaryTree<int>::const_iterator it = frozen.begin(); it != frozen.end(); ++it) {
+            if (even(*it)) {
+                out[count++] = *it;
+            }
+        }
+        return count;
+    }, selected);
+    std::cout << "even, frozen iterator      " << gbs << " GB/s (" << selected << " keys)" << std::endl;
+    gbs = measure(bytes, [&]() { return frozen.filter_simd(simdEven, out.data()); }, selected);
+    std::cout << "even, filter_simd          " << gbs << " GB/s (" << selected << " keys)" << std::endl;
+    gbs = measure(bytes, [&]() {
+        size_t count = 0;
+        for (FrozenBinaryTree<int>::const_iterator it = frozen.begin(); it != frozen.end(); ++it) {
+            if (*it >= lo && *it <= hi && even(*it)) {
+                out[count++] = *it;
+            }
+        }
+        return count;
+    }, selected);
+    std::cout << "even in range, iterator    " << gbs << " GB/s (" << selected << " keys)" << std::endl;
+    gbs = measure(bytes, [&]() { return frozen.filter_simd(simdRange, out.data()); }, selected);
+    std::cout << "even in range, filter_simd " << gbs << " GB/s (" << selected << " keys)" << std::endl;
+    return 0;
+}
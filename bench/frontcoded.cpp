@@ -0,0 +1,115 @@
+/**
+ * @file frontcoded.cpp
+ * @brief Memoria e velocità di FrontCodedStringTree rispetto agli altri alberi di stringhe.
+ *
+ * Genera chiavi simili a URL (prefissi lunghi e condivisi), le inserisce in
+ * un BinaryTree<std::string> e ne costruisce un FrozenBinaryTree e un
+ * FrontCodedStringTree per diverse dimensioni di blocco. Per ognuno stampa
+ * la memoria occupata (misurata con mallinfo2 su glibc, blocchi allocati con
+ * mmap compresi; per FrontCodedStringTree quella riportata da memory_bytes),
+ * il tempo per le ricerche di chiavi presenti e assenti e quello di una
+ * scansione in ordine.
+ *
+ * Uso: bench_frontcoded.exe [n]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "binarytree.hpp"
+#include "frozen_tree.hpp"
+#include "frontcoded_tree.hpp"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Byte attualmente allocati nello heap (0 se non misurabile).
+ *
+ * Le allocazioni grandi (oltre M_MMAP_THRESHOLD) non passano dall'arena:
+ * uordblks non le conta, hblkhd sì.
+ */
+static size_t heap_bytes() {
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Misura ricerche e scansione di una struttura e ne stampa i risultati.
+ *
+ * @param name Nome della struttura.
+ * @param tree Struttura da misurare.
+ * @param bytes Memoria occupata.
+ * @param queries Chiavi da cercare.
+ */
+template<typename Tree>
+static void report(const char* name, const Tree& tree, size_t bytes, const std::vector<std::string>& queries) {
+    size_t found = 0;
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < queries.size(); ++i) {
+        found += tree.exists(queries[i]);
+    }
+    double lookup = std::chrono::duration<double>(Clock::now() - t0).count();
+    size_t length = 0;
+    t0 = Clock::now();
+    for (typename Tree::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+        length += it->size();
+    }
+    double scan = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << name << (bytes >> 20) << " MiB, exists " << lookup / queries.size() * 1e9 << " ns, scan "
+              << scan * 1e3 << " ms (found " << found << ", " << (length >> 20) << " MiB of keys)" << std::endl;
+}
+
+/**
+ * @brief Funzione principale del benchmark.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const char* hosts[] = {"https://www.example.com", "https://docs.example.org", "https://shop.example.net",
+                           "https://static.cdn.example.com"};
+    const char* sections[] = {"/products/catalog/", "/articles/2024/archive/", "/users/profiles/settings/",
+                              "/api/v2/resources/items/"};
+    std::mt19937 rng(3);
+    std::vector<std::string> keys;
+    std::vector<std::string> queries;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys.push_back(std::string(hosts[rng() % 4]) + sections[rng() % 4] + std::to_string(rng() % (n * 4)));
+    }
+    for (size_t i = 0; i < 200000; ++i) {
+        queries.push_back(i % 2 ? keys[rng() % n] : keys[rng() % n] + "x");
+    }
+
+    size_t before = heap_bytes();
+    BinaryTree<std::string> tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.try_insert(keys[i]);
+    }
+    size_t tree_bytes = heap_bytes() - before;
+    std::cout << tree.size() << " distinct URL-like keys" << std::endl;
+    report("BinaryTree              ", tree, tree_bytes, queries);
+
+    before = heap_bytes();
+    FrozenBinaryTree<std::string> frozen(tree);
+    report("FrozenBinaryTree        ", frozen, heap_bytes() - before, queries);
+
+    const size_t block_sizes[] = {16, 32, 64};
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); ++b) {
+        FrontCodedStringTree<> coded(tree, block_sizes[b]);
+        size_t bytes = coded.memory_bytes();
+        std::string name = "FrontCoded(block=" + std::to_string(block_sizes[b]) + ")     ";
+        report(name.c_str(), coded, bytes, queries);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file noexcept.cpp
+ * @brief Confronto tra la build con eccezioni e quella senza eccezioni.
+ *
+ * Lo stesso sorgente viene compilato due volte: normalmente e con
+ * -fno-exceptions -DBINARYTREE_NO_EXCEPTIONS (vedi il target bench-noexcept
+ * del Makefile, che stampa anche la dimensione dei due eseguibili). I carichi
+ * usano solo API disponibili in entrambe le configurazioni; nella build con
+ * eccezioni si misura in più il costo di segnalare i duplicati lanciando.
+ *
+ * Uso: bench_noexcept_*.exe [n]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "binarytree.hpp"
+
+typedef std::chrono::steady_clock Clock;
+typedef BinaryTree<int> Tree;
+
+static volatile size_t sink; ///< Impedisce al compilatore di eliminare i risultati.
+
+/**
+ * @brief Misura il minimo tempo per operazione di una funzione su più ripetizioni.
+ *
+ * @param ops Operazioni eseguite da ogni chiamata di f.
+ * @param f Funzione da misurare.
+ * @return double Nanosecondi per operazione.
+ */
+template<typename F>
+static double measure(size_t ops, F f) {
+    f();
+    double best = 1e300;
+    for (int r = 0; r < 5; ++r) {
+        Clock::time_point t0 = Clock::now();
+        f();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        best = std::min(best, ns / static_cast<double>(ops));
+    }
+    return best;
+}
+
+/**
+ * @brief Funzione principale del benchmark.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = static_cast<int>(2 * i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+    // Metà delle chiavi ripete una chiave già inserita.
+    std::vector<int> mixed(keys.begin(), keys.begin() + n / 2);
+    mixed.insert(mixed.end(), keys.begin(), keys.begin() + n / 2);
+    std::shuffle(mixed.begin() + n / 2, mixed.end(), std::mt19937(8));
+
+    Tree tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(keys[i]);
+    }
+
+#ifdef BINARYTREE_NO_EXCEPTIONS
+    std::printf("build: no exceptions, n = %zu\n", n);
+#else
+    std::printf("build: exceptions, n = %zu\n", n);
+#endif
+
+    std::printf("%-20s %8.2f ns/op\n", "insert", measure(n, [&]() {
+        Tree t;
+        for (size_t i = 0; i < n; ++i) {
+            t.insert(keys[i]);
+        }
+        sink = t.size();
+    }));
+    std::printf("%-20s %8.2f ns/op\n", "try_insert_dup50", measure(mixed.size(), [&]() {
+        Tree t;
+        size_t duplicates = 0;
+        for (size_t i = 0; i < mixed.size(); ++i) {
+            duplicates += t.try_insert(mixed[i]) == TreeError::duplicate;
+        }
+        sink = duplicates;
+    }));
+#ifndef BINARYTREE_NO_EXCEPTIONS
+    std::printf("%-20s %8.2f ns/op\n", "insert_dup50_throw", measure(mixed.size(), [&]() {
+        Tree t;
+        size_t duplicates = 0;
+        for (size_t i = 0; i < mixed.size(); ++i) {
+            try {
+                t.insert(mixed[i]);
+            } catch (std::runtime_error&) {
+                duplicates++;
+            }
+        }
+        sink = duplicates;
+    }));
+#endif
+    std::printf("%-20s %8.2f ns/op\n", "exists", measure(n, [&]() {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i) {
+            found += tree.exists(keys[i] + (i & 1));
+        }
+        sink = found;
+    }));
+    std::printf("%-20s %8.2f ns/op\n", "try_assign", measure(n, [&]() {
+        Tree copy;
+        sink = copy.try_assign(tree) == TreeError::none ? copy.size() : 0;
+    }));
+    std::printf("%-20s %8.2f ns/op\n", "try_bulk_build", measure(n, [&]() {
+        TreeResult<Tree> built = Tree::try_bulk_build(keys.begin(), keys.end());
+        sink = built ? built->size() : 0;
+    }));
+    return 0;
+}
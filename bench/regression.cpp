@@ -0,0 +1,334 @@
+/**
+ * @file regression.cpp
+ * @brief Suite di regressione delle prestazioni con baseline salvate.
+ *
+ * Esegue una matrice fissa di casi: le quattro istanze di main.cpp (int,
+ * double, string, CustomType) più int con std::less (int_less, l'istanza in
+ * cui bulk_build ordina con radix_sort) per ogni carico (insert, exists_hit,
+ * exists_miss, iterate, copy, subtree, bulk_build) e per ogni dimensione.
+ * Per ogni caso misura il tempo per operazione (minimo su più ripetizioni,
+ * il valore meno sensibile al rumore) e lo confronta con il file di baseline.
+ * Le ripetizioni sono passate successive sull'intera matrice, non
+ * ripetizioni consecutive dello stesso caso: un disturbo di qualche decimo
+ * di secondo sulla macchina colpisce così una sola ripetizione per caso
+ * invece di tutte.
+ * Un caso regredisce se è più lento della baseline oltre la soglia relativa;
+ * un caso assente dalla baseline (MISSING) non può essere confrontato e
+ * conta come un fallimento, così un caso nuovo non resta mai senza
+ * riferimento. In entrambi i casi il programma termina con codice 1 dopo il
+ * resoconto completo.
+ *
+ * Uso: bench_regression.exe [--baseline file] [--threshold 0.20] [--reps n] [--filter testo] [--update]
+ *   --update riscrive il file di baseline con i valori misurati.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "binarytree.hpp"
+#include "test_types.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Genera la chiave di indice i per ciascuna istanza.
+ *
+ * Gli indici pari vengono inseriti, quelli dispari servono per le ricerche mancate.
+ */
+template<typename T>
+struct KeyMaker;
+
+template<>
+struct KeyMaker<int> {
+    static int make(size_t i) { return static_cast<int>(i); }
+};
+
+template<>
+struct KeyMaker<double> {
+    static double make(size_t i) { return static_cast<double>(i) * 0.5 + 0.25; }
+};
+
+template<>
+struct KeyMaker<std::string> {
+    static std::string make(size_t i) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "key-%010zu", i);
+        return buf;
+    }
+};
+
+template<>
+struct KeyMaker<CustomType> {
+    static CustomType make(size_t i) {
+        CustomType ct = {static_cast<int>(i), "record"};
+        return ct;
+    }
+};
+
+/**
+ * @brief Dati di input condivisi dai carichi di una dimensione.
+ */
+template<typename T>
+struct Workload {
+    std::vector<T> present; ///< Chiavi inserite, in ordine casuale.
+    std::vector<T> absent; ///< Chiavi mai inserite, in ordine casuale.
+
+    explicit Workload(size_t n) {
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::mt19937_64 rng(12345);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (size_t i = 0; i < n; ++i) {
+            present.push_back(KeyMaker<T>::make(2 * order[i]));
+            absent.push_back(KeyMaker<T>::make(2 * order[i] + 1));
+        }
+    }
+};
+
+static volatile size_t sink; ///< Impedisce al compilatore di eliminare i risultati.
+
+static const double min_rep_ns = 20e6; ///< Durata minima di una ripetizione: i casi piccoli vengono ripetuti.
+
+/**
+ * @brief Misura il tempo per operazione di una funzione in una ripetizione.
+ *
+ * Dopo una chiamata di riscaldamento invoca f finché non sono trascorsi
+ * almeno min_rep_ns nanosecondi.
+ *
+ * @param ops Operazioni eseguite da ogni chiamata di f.
+ * @param f Funzione da misurare.
+ * @return double Nanosecondi per operazione.
+ */
+template<typename F>
+static double measure(size_t ops, F f) {
+    f();
+    Clock::time_point t0 = Clock::now();
+    size_t calls = 0;
+    double ns = 0;
+    do {
+        f();
+        calls++;
+        ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    } while (ns < min_rep_ns);
+    return ns / static_cast<double>(ops * calls);
+}
+
+/**
+ * @brief Registra una ripetizione di un caso, conservando il minimo.
+ */
+static void keep_best(std::map<std::string, double>& results, const std::string& key, double ns) {
+    std::map<std::string, double>::iterator it = results.find(key);
+    if (it == results.end()) {
+        results[key] = ns;
+    } else {
+        it->second = std::min(it->second, ns);
+    }
+}
+
+/**
+ * @brief Esegue una ripetizione di tutti i carichi di un'istanza per una dimensione.
+ */
+template<typename T, typename Compare, typename Equal>
+static void run_type(const std::string& type, size_t n, const std::string& filter,
+                     std::map<std::string, double>& results) {
+    typedef BinaryTree<T, Compare, Equal> Tree;
+    Workload<T> w(n);
+    Tree tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(w.present[i]);
+    }
+    std::ostringstream suffix;
+    suffix << "/" << n;
+    std::string prefix = type + "/";
+
+#define BENCH_CASE(name, ops, body)                                             \
+    do {                                                                        \
+        std::string key = prefix + name + suffix.str();                         \
+        if (key.find(filter) != std::string::npos) {                            \
+            keep_best(results, key, measure(ops, [&]() { body; }));             \
+        }                                                                       \
+    } while (0)
+
+    BENCH_CASE("insert", n, {
+        Tree t;
+        for (size_t i = 0; i < n; ++i) {
+            t.insert(w.present[i]);
+        }
+        sink = t.size();
+    });
+    BENCH_CASE("exists_hit", n, {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i) {
+            found += tree.exists(w.present[i]);
+        }
+        sink = found;
+    });
+    BENCH_CASE("exists_miss", n, {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i) {
+            found += tree.exists(w.absent[i]);
+        }
+        sink = found;
+    });
+    Tree cached(tree);
+    cached.enable_top_cache(12);
+    BENCH_CASE("exists_hit_top_cache", n, {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i) {
+            found += cached.exists(w.present[i]);
+        }
+        sink = found;
+    });
+    BENCH_CASE("iterate", n, {
+        size_t count = 0;
+        for (typename Tree::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            count++;
+        }
+        sink = count;
+    });
+    BENCH_CASE("copy", n, {
+        Tree copy(tree);
+        sink = copy.size();
+    });
+    // present[0] è la radice: subtree copia l'intero albero e poi ne conta i nodi.
+    BENCH_CASE("subtree", n, {
+        Tree sub = tree.subtree(w.present[0]);
+        sink = sub.size();
+    });
+    BENCH_CASE("bulk_build", n, {
+        Tree t = Tree::bulk_build(w.present.begin(), w.present.end());
+        sink = t.size();
+    });
+    BENCH_CASE("copy_if_half", n, {
+        size_t k = 0;
+        Tree t = tree.copy_if([&k](const T&) { return k++ % 2 == 0; });
+        sink = t.size();
+    });
+#undef BENCH_CASE
+}
+
+/**
+ * @brief Legge un file di baseline nel formato scritto da write_baseline.
+ *
+ * Il parser riconosce solo coppie "nome": numero, l'unica forma prodotta.
+ */
+static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> values;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t q1 = line.find('"');
+        size_t q2 = q1 == std::string::npos ? q1 : line.find('"', q1 + 1);
+        size_t colon = q2 == std::string::npos ? q2 : line.find(':', q2);
+        if (colon == std::string::npos) {
+            continue;
+        }
+        const char* num = line.c_str() + colon + 1;
+        char* end = nullptr;
+        double v = std::strtod(num, &end);
+        if (end != num) {
+            values[line.substr(q1 + 1, q2 - q1 - 1)] = v;
+        }
+    }
+    return values;
+}
+
+static void write_baseline(const std::string& path, const std::map<std::string, double>& values) {
+    std::ofstream out(path.c_str());
+    out << "{\n  \"unit\": \"ns_per_op\",\n  \"cases\": {\n";
+    for (std::map<std::string, double>::const_iterator it = values.begin(); it != values.end(); ++it) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.3f", it->second);
+        out << "    \"" << it->first << "\": " << buf << (std::next(it) == values.end() ? "\n" : ",\n");
+    }
+    out << "  }\n}\n";
+}
+
+/**
+ * @brief Funzione principale della suite.
+ *
+ * @return int 0 se nessun caso regredisce o manca dalla baseline, 1 altrimenti.
+ */
+int main(int argc, char** argv) {
+    std::string baseline_path = "bench/baseline.json";
+    double threshold = 0.20;
+    int reps = 5;
+    bool update = false;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--update") {
+            update = true;
+        } else {
+            std::cerr << "Usage: bench_regression.exe [--baseline file] [--threshold 0.20] [--reps n] [--filter text] [--update]" << std::endl;
+            return 2;
+        }
+    }
+
+    const size_t sizes[] = {1000, 10000, 100000};
+    std::map<std::string, double> results;
+    for (int pass = 0; pass < reps; ++pass) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            run_type<int, IntCompare, IntEqual>("int", sizes[s], filter, results);
+            run_type<int, std::less<int>, std::equal_to<int> >("int_less", sizes[s], filter, results);
+            run_type<double, DoubleCompare, DoubleEqual>("double", sizes[s], filter, results);
+            run_type<std::string, StringCompare, StringEqual>("string", sizes[s], filter, results);
+            run_type<CustomType, CustomTypeCompare, CustomTypeEqual>("custom", sizes[s], filter, results);
+        }
+    }
+
+    if (update) {
+        std::map<std::string, double> merged = read_baseline(baseline_path);
+        for (std::map<std::string, double>::const_iterator it = results.begin(); it != results.end(); ++it) {
+            merged[it->first] = it->second;
+        }
+        write_baseline(baseline_path, merged);
+        std::cout << "Updated " << results.size() << " cases in " << baseline_path << std::endl;
+        return 0;
+    }
+
+    std::map<std::string, double> baseline = read_baseline(baseline_path);
+    int regressions = 0;
+    int missing = 0;
+    std::printf("%-38s %12s %12s %9s  %s\n", "case", "baseline", "current", "delta", "status");
+    for (std::map<std::string, double>::const_iterator it = results.begin(); it != results.end(); ++it) {
+        std::map<std::string, double>::const_iterator base = baseline.find(it->first);
+        if (base == baseline.end()) {
+            std::printf("%-38s %12s %12.2f %9s  MISSING\n", it->first.c_str(), "-", it->second, "-");
+            missing++;
+            continue;
+        }
+        double delta = (it->second - base->second) / base->second;
+        const char* status = "ok";
+        if (delta > threshold) {
+            status = "REGRESSED";
+            regressions++;
+        } else if (delta < -threshold) {
+            status = "improved";
+        }
+        std::printf("%-38s %12.2f %12.2f %+8.1f%%  %s\n", it->first.c_str(), base->second, it->second, delta * 100, status);
+    }
+    std::printf("%d of %zu cases regressed beyond %.0f%% (ns/op)\n", regressions, results.size(), threshold * 100);
+    if (missing) {
+        std::printf("%d cases are MISSING from %s: add them with --filter <case> --update\n", missing, baseline_path.c_str());
+    }
+    return regressions || missing ? 1 : 0;
+}
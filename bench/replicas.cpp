@@ -0,0 +1,128 @@
+/**
+ * @file replicas.cpp
+ * @brief Throughput di lettura in funzione del numero di thread, con e senza repliche.
+ *
+ * Confronta exists su un unico BinaryTree condiviso con exists su un
+ * ReplicatedBinaryTree (una replica per gruppo di core), prima in sola
+ * lettura e poi con un thread che inserisce una chiave ogni write_every_us
+ * microsecondi. Le chiavi cercate sono per metà presenti.
+ *
+ * Uso: bench_replicas.exe [n] [max_threads]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "binarytree.hpp"
+#include "replicated_tree.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static const int duration_ms = 300; ///< Durata di ogni misura.
+static const int write_every_us = 200; ///< Intervallo tra due scritture nel carico misto.
+
+static std::atomic<size_t> sink; ///< Impedisce al compilatore di eliminare i risultati.
+
+/**
+ * @brief Esegue lookup da più thread per duration_ms e restituisce il throughput.
+ *
+ * @param threads Numero di thread lettori.
+ * @param lookup Funzione di ricerca, invocata con una chiave.
+ * @param writer Funzione di scrittura (nullptr = sola lettura), invocata con una chiave nuova.
+ * @param key_range Le chiavi cercate sono in [0, key_range).
+ * @return double Milioni di lookup al secondo.
+ */
+template<typename Lookup, typename Writer>
+static double run(unsigned threads, Lookup lookup, Writer* writer, int key_range) {
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> total(0);
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < threads; ++t) {
+        readers.emplace_back([&, t]() {
+            std::mt19937 rng(t + 1);
+            size_t local = 0;
+            size_t found = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    found += lookup(static_cast<int>(rng() % static_cast<unsigned>(key_range)));
+                }
+                local += 256;
+            }
+            total.fetch_add(local, std::memory_order_relaxed);
+            sink.fetch_add(found, std::memory_order_relaxed);
+        });
+    }
+    std::thread write_thread;
+    if (writer) {
+        write_thread = std::thread([&]() {
+            int next = key_range;
+            while (!stop.load(std::memory_order_relaxed)) {
+                (*writer)(next);
+                next += 2;
+                std::this_thread::sleep_for(std::chrono::microseconds(write_every_us));
+            }
+        });
+    }
+    Clock::time_point t0 = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    stop = true;
+    for (size_t t = 0; t < readers.size(); ++t) {
+        readers[t].join();
+    }
+    if (write_thread.joinable()) {
+        write_thread.join();
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    return total.load() / secs / 1e6;
+}
+
+/**
+ * @brief Funzione principale del benchmark.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+                                    : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = static_cast<int>(2 * i);
+    }
+    BinaryTree<int> shared = BinaryTree<int>::bulk_build(keys.begin(), keys.end());
+    std::mutex shared_lock;
+    ReplicatedBinaryTree<int> replicated(shared);
+    int key_range = static_cast<int>(2 * n);
+
+    std::printf("n = %zu, %u replicas, %u hardware threads\n", n, replicated.replica_count(),
+                std::thread::hardware_concurrency());
+    std::printf("%8s %14s %14s %14s %14s\n", "threads", "shared", "replicated", "shared+w", "replicated+w");
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        auto shared_lookup = [&](int key) { return shared.exists(key); };
+        // Con le scritture l'albero condiviso va protetto da un lock anche in lettura.
+        auto locked_lookup = [&](int key) {
+            std::lock_guard<std::mutex> guard(shared_lock);
+            return shared.exists(key);
+        };
+        auto replicated_lookup = [&](int key) { return replicated.exists(key); };
+        std::function<void(int)> shared_writer = [&](int key) {
+            std::lock_guard<std::mutex> guard(shared_lock);
+            shared.try_insert(key);
+        };
+        std::function<void(int)> replicated_writer = [&](int key) { replicated.try_insert(key); };
+        std::function<void(int)>* none = nullptr;
+        double a = run(threads, shared_lookup, none, key_range);
+        double b = run(threads, replicated_lookup, none, key_range);
+        double c = run(threads, locked_lookup, &shared_writer, key_range);
+        double d = run(threads, replicated_lookup, &replicated_writer, key_range);
+        std::printf("%8u %11.2f M/s %11.2f M/s %11.2f M/s %11.2f M/s\n", threads, a, b, c, d);
+    }
+    return 0;
+}
@@ -3,244 +3,2750 @@
 
 #include <iostream>
 #include <functional>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <thread>
 #include <stdexcept> // Per std::runtime_error
+#include "radix_sort.hpp"
+
+// Senza supporto alle eccezioni (-fno-exceptions) la modalità senza eccezioni si attiva da sola.
+#if !defined(BINARYTREE_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS)
+#define BINARYTREE_NO_EXCEPTIONS 1
+#endif
 
 /**
- * @brief Classe template per un albero binario.
+ * @def BINARYTREE_TRY
+ * @brief Apre un blocco protetto; senza eccezioni è un semplice blocco.
+ * @def BINARYTREE_CATCH_RETHROW
+ * @brief Chiude un blocco protetto rilanciando l'eccezione.
+ * @def BINARYTREE_CATCH_CLEANUP
+ * @brief Chiude un blocco protetto eseguendo una pulizia prima di rilanciare.
+ */
+#ifndef BINARYTREE_NO_EXCEPTIONS
+#define BINARYTREE_TRY try
+#define BINARYTREE_CATCH_RETHROW catch (std::exception&) { throw; /* Rilancia l'eccezione */ }
+#define BINARYTREE_CATCH_CLEANUP(cleanup) catch (std::exception&) { cleanup; throw; /* Rilancia l'eccezione */ }
+#else
+#define BINARYTREE_TRY
+#define BINARYTREE_CATCH_RETHROW
+#define BINARYTREE_CATCH_CLEANUP(cleanup)
+#endif
+
+/**
+ * @brief Codici di errore delle operazioni sugli alberi.
+ */
+enum class TreeError {
+    none,          ///< Nessun errore.
+    duplicate,     ///< Inserimento di un elemento già presente.
+    out_of_memory, ///< Allocazione di un nodo fallita.
+    out_of_order,  ///< Chiavi fuori ordine: spostamento che romperebbe l'ordine dell'albero o sequenza non crescente.
+    io_error,      ///< Checkpoint o istantanea non scrivibile, mancante o danneggiato.
+    out_of_range   ///< Modifica delle chiavi che uscirebbe dai valori del tipo delle chiavi.
+};
+
+/**
+ * @brief Restituisce il messaggio associato a un codice di errore.
  * 
- * @tparam T Tipo dei dati contenuti nel nodo dell'albero.
- * @tparam Compare Functore per confrontare due oggetti di tipo T.
- * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @param err Codice di errore.
+ * @return const char* Messaggio descrittivo.
  */
-template<typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
-class BinaryTree {
+inline const char* tree_error_message(TreeError err) {
+    switch (err) {
+    case TreeError::none:
+        return "No error.";
+    case TreeError::duplicate:
+        return "Duplicate element insertion is not allowed.";
+    case TreeError::out_of_memory:
+        return "Out of memory.";
+    case TreeError::out_of_order:
+        return "Keys out of order: a shift would break the tree order or the input is not strictly increasing.";
+    case TreeError::io_error:
+        return "I/O error or corrupted checkpoint or snapshot file.";
+    case TreeError::out_of_range:
+        return "Key shift would overflow the key type.";
+    }
+    return "Unknown error.";
+}
+
+namespace binarytree_detail {
+
+/**
+ * @brief Segnala un errore a un chiamante delle API che non restituiscono codici.
+ * 
+ * Con le eccezioni lancia std::bad_alloc per out_of_memory e std::runtime_error
+ * per gli altri errori; senza eccezioni stampa il messaggio e termina il
+ * programma, come fa la libreria standard compilata con -fno-exceptions.
+ * Chi non vuole terminare deve usare le varianti try_*.
+ * 
+ * @param err Codice di errore (diverso da TreeError::none).
+ */
+[[noreturn]] inline void raise(TreeError err) {
+#ifndef BINARYTREE_NO_EXCEPTIONS
+    if (err == TreeError::out_of_memory) {
+        throw std::bad_alloc();
+    }
+    throw std::runtime_error(tree_error_message(err));
+#else
+    std::fputs(tree_error_message(err), stderr);
+    std::fputc('\n', stderr);
+    std::abort();
+#endif
+}
+
+static const unsigned max_spawn_depth = 10; ///< Livelli di divisione massimi (al più 1024 thread).
+
+/**
+ * @brief Livelli di albero in cui dividere il lavoro per usare al più threads thread.
+ *
+ * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+ * @return unsigned Il minimo d tale che 2^d >= threads, limitato a max_spawn_depth.
+ */
+inline unsigned spawn_depth(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    unsigned depth = 0;
+    while (depth < max_spawn_depth && (1u << depth) < threads) {
+        depth++;
+    }
+    return depth;
+}
+
+/**
+ * @brief Distrugge ricorsivamente un sottoalbero di nodi allocati con new.
+ *
+ * Condivisa dagli alberi i cui nodi hanno i campi left e right (BinaryTree, KdTree).
+ *
+ * @param node Radice del sottoalbero da distruggere (può essere nullptr).
+ */
+template<typename Node>
+void destroy_subtree(Node* node) {
+    if (!node) {
+        return;
+    }
+    destroy_subtree(node->left);
+    destroy_subtree(node->right);
+    delete node;
+}
+
+/**
+ * @brief Copia ricorsivamente un sottoalbero nodo per nodo.
+ *
+ * Se un'allocazione fallisce la copia parziale resta collegata a dest, così
+ * il chiamante può liberarla con destroy_subtree.
+ *
+ * @param dest Radice del sottoalbero di destinazione.
+ * @param src Radice del sottoalbero sorgente (non nullptr).
+ * @param parent Padre da assegnare alla radice copiata.
+ * @param clone Invocata con (src, parent), alloca la copia di un nodo (nullptr se fallisce).
+ * @param finish Invocata su ogni nodo copiato dopo i suoi figli.
+ * @return true Se la copia è completa.
+ * @return false Se un'allocazione è fallita.
+ */
+template<typename Node, typename Clone, typename Finish>
+bool copy_subtree(Node*& dest, const Node* src, Node* parent, Clone& clone, Finish& finish) {
+    dest = clone(src, parent);
+    if (!dest) {
+        return false;
+    }
+    if (src->left && !copy_subtree(dest->left, src->left, dest, clone, finish)) {
+        return false;
+    }
+    if (src->right && !copy_subtree(dest->right, src->right, dest, clone, finish)) {
+        return false;
+    }
+    finish(dest);
+    return true;
+}
+
+/**
+ * @brief Costruisce ricorsivamente un sottoalbero bilanciato sugli indici [lo, hi).
+ *
+ * Se un'allocazione fallisce il sottoalbero corrispondente resta vuoto: il
+ * chiamante lo riconosce contando i nodi creati da make.
+ *
+ * @param lo Indice del primo elemento dell'intervallo.
+ * @param hi Indice successivo all'ultimo elemento dell'intervallo.
+ * @param depth Profondità del sottoalbero.
+ * @param parent Padre da assegnare alla radice del sottoalbero.
+ * @param split Invocata con (lo, hi, depth), restituisce l'indice della radice in [lo, hi).
+ * @param make Invocata con (indice, parent), alloca il nodo (nullptr se fallisce).
+ * @param finish Invocata su ogni nodo dopo la costruzione dei suoi figli.
+ * @return Node* Radice del sottoalbero costruito.
+ */
+template<typename Node, typename Split, typename Make, typename Finish>
+Node* build_subtree(size_t lo, size_t hi, size_t depth, Node* parent, Split& split, Make& make, Finish& finish) {
+    if (lo >= hi) {
+        return nullptr;
+    }
+    size_t mid = split(lo, hi, depth);
+    Node* node = make(mid, parent);
+    if (!node) {
+        return nullptr;
+    }
+    node->left = build_subtree(lo, mid, depth + 1, node, split, make, finish);
+    node->right = build_subtree(mid + 1, hi, depth + 1, node, split, make, finish);
+    finish(node);
+    return node;
+}
+
+/**
+ * @brief Vero se i nodi con chiavi di tipo T portano uno spostamento in sospeso.
+ *
+ * Solo con BINARYTREE_LAZY_SHIFT: altrimenti shift aggiorna le chiavi una per una.
+ */
+template<typename T>
+struct has_lazy_shift {
+#ifdef BINARYTREE_LAZY_SHIFT
+    static const bool value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+#else
+    static const bool value = false;
+#endif
+};
+
+/**
+ * @brief Somma due chiavi aritmetiche solo se il risultato è rappresentabile in T.
+ *
+ * @param a Primo addendo.
+ * @param b Secondo addendo.
+ * @param sum Riceve la somma, se rappresentabile.
+ * @return true Se la somma non trabocca (per la virgola mobile: se non diventa infinita).
+ */
+template<typename T>
+bool checked_add(const T& a, const T& b, T& sum) {
+    if constexpr (std::is_integral<T>::value) {
+        if (b > T() ? a > std::numeric_limits<T>::max() - b : a < std::numeric_limits<T>::min() - b) {
+            return false;
+        }
+    }
+    sum = static_cast<T>(a + b);
+    if constexpr (std::is_floating_point<T>::value) {
+        if (std::isinf(sum) && !std::isinf(a)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Somma modulare per gli spostamenti in sospeso.
+ *
+ * Le etichette accumulate possono uscire dal tipo anche quando ogni chiave
+ * resta rappresentabile: per i tipi interi la somma si fa sul tipo senza
+ * segno, così il risultato, riportato a T, è corretto quando lo è la chiave.
+ */
+template<typename T>
+T wrapping_add(const T& a, const T& b) {
+    if constexpr (std::is_integral<T>::value) {
+        typedef typename std::make_unsigned<T>::type U;
+        return static_cast<T>(static_cast<U>(static_cast<U>(a) + static_cast<U>(b)));
+    } else {
+        return static_cast<T>(a + b);
+    }
+}
+
+/**
+ * @brief Differenza modulare, inversa di wrapping_add.
+ */
+template<typename T>
+T wrapping_sub(const T& a, const T& b) {
+    if constexpr (std::is_integral<T>::value) {
+        typedef typename std::make_unsigned<T>::type U;
+        return static_cast<T>(static_cast<U>(static_cast<U>(a) - static_cast<U>(b)));
+    } else {
+        return static_cast<T>(a - b);
+    }
+}
+
+/**
+ * @brief Massima potenza di due di cui x è multiplo.
+ *
+ * @param x Valore finito diverso da zero.
+ */
+template<typename T>
+T float_low_bit(const T& x) {
+    const int digits = std::numeric_limits<T>::digits;
+    int exponent = 0;
+    T mantissa = std::frexp(std::fabs(x), &exponent);
+    if constexpr (std::numeric_limits<T>::digits <= 64) {
+        // La mantissa scalata è un intero: si contano i suoi zeri finali.
+        uint64_t bits = static_cast<uint64_t>(std::ldexp(mantissa, digits));
+        int zeros = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            zeros++;
+        }
+        return std::ldexp(T(1), exponent - digits + zeros);
+    } else {
+        T bit = std::ldexp(T(1), exponent - digits);
+        while (std::fmod(std::fabs(x), bit * 2) == T()) {
+            bit *= 2;
+        }
+        return bit;
+    }
+}
+
+/**
+ * @brief Vero se |a| + |b| sta sotto 2^digits * grid, cioè se ogni multiplo
+ *        di grid con modulo al più |a| + |b| è rappresentabile esattamente.
+ */
+template<typename T>
+bool float_fits_grid(const T& a, const T& b, const T& grid) {
+    T sum = std::fabs(a) + std::fabs(b);
+    return std::isfinite(sum) && sum < std::ldexp(grid, std::numeric_limits<T>::digits);
+}
+
+/**
+ * @brief Limite degli spostamenti in sospeso che si sommano senza arrotondamenti.
+ *
+ * Con BINARYTREE_LAZY_SHIFT e chiavi in virgola mobile ogni etichetta e ogni
+ * spostamento accumulato da una lettura è la somma di un sottoinsieme degli
+ * spostamenti etichettati dall'ultimo flush_shifts. Se questi e tutte le
+ * chiavi sono multipli di una stessa potenza di due g, e sia la somma dei
+ * moduli degli spostamenti sia ogni chiave spostata restano sotto
+ * 2^digits * g, tutte le somme sono esatte. Per gli altri tipi la struttura
+ * è vuota e accetta tutto.
+ */
+template<typename T, bool = has_lazy_shift<T>::value && std::is_floating_point<T>::value>
+struct shift_budget {
+    T quantum;     ///< Potenza di due che divide gli spostamenti contati (infinito se nessuno).
+    T total;       ///< Somma dei moduli degli spostamenti contati.
+    T key_quantum; ///< Potenza di due che divide tutte le chiavi (infinito se nessuna).
+
+    shift_budget()
+        : quantum(std::numeric_limits<T>::infinity()), total(), key_quantum(std::numeric_limits<T>::infinity()) {}
+
+    /**
+     * @brief Registra una chiave entrata nell'albero.
+     */
+    void note_key(const T& key) {
+        if (key != T() && std::isfinite(key)) {
+            key_quantum = std::min(key_quantum, float_low_bit(key));
+        }
+    }
+
+    /**
+     * @brief Conta uno spostamento se tutte le somme restano esatte.
+     *
+     * @param delta Spostamento da etichettare.
+     * @param key_max Massimo modulo delle chiavi da spostare.
+     * @return true Se lo spostamento è stato contato.
+     * @return false Se potrebbe arrotondare: il limite non cambia.
+     */
+    bool reserve(const T& delta, const T& key_max = T()) {
+        if (delta == T()) {
+            return true;
+        }
+        if (!std::isfinite(delta)) {
+            return false;
+        }
+        T delta_quantum = float_low_bit(delta);
+        T grid = std::min(std::min(delta_quantum, quantum), key_quantum);
+        if (!float_fits_grid(total, delta, grid) || !float_fits_grid(key_max, delta, grid)) {
+            return false;
+        }
+        quantum = std::min(quantum, delta_quantum);
+        key_quantum = std::min(key_quantum, delta_quantum);
+        total += std::fabs(delta);
+        return true;
+    }
+
+    /**
+     * @brief Conta uno spostamento già presente nell'albero (ad esempio letto
+     *        da un checkpoint); se non entra nel limite lo esaurisce.
+     */
+    void absorb(const T& delta) {
+        if (!reserve(delta)) {
+            total = std::numeric_limits<T>::infinity();
+        }
+    }
+
+    /**
+     * @brief Azzera gli spostamenti contati dopo che sono stati tutti applicati.
+     */
+    void reset() {
+        quantum = std::numeric_limits<T>::infinity();
+        total = T();
+    }
+};
+
+template<typename T>
+struct shift_budget<T, false> {
+    void note_key(const T&) {}
+    bool reserve(const T&, const T& = T()) { return true; }
+    void absorb(const T&) {}
+    void reset() {}
+};
+
+/**
+ * @brief Spostamento in sospeso da applicare ai sottoalberi dei figli di un nodo.
+ * 
+ * Per i tipi non aritmetici la base è vuota e non occupa spazio nel nodo.
+ */
+template<typename T, bool = has_lazy_shift<T>::value>
+struct shift_tag {
+    T pending; ///< Spostamento non ancora applicato ai figli.
+#ifdef BINARYTREE_CHECKPOINTS
+    T persist_shift; ///< Spostamento ricevuto dal nodo dopo la scrittura del suo record di checkpoint.
+
+    shift_tag() : pending(), persist_shift() {}
+#else
+    shift_tag() : pending() {}
+#endif
+};
+
+template<typename T>
+struct shift_tag<T, false> {};
+
+/**
+ * @brief Spostamento ereditato dagli antenati di un nodo e non ancora applicato alla sua chiave.
+ *
+ * Le letture lo accumulano lungo la discesa invece di applicarlo ai nodi,
+ * così i metodi const non scrivono mai nell'albero e possono essere
+ * chiamati da più thread insieme. Le chiavi lette sono copie già spostate.
+ */
+template<typename T, bool = has_lazy_shift<T>::value>
+struct shift_offset {
+    typedef T reference; ///< Tipo della chiave letta: una copia spostata.
+
+    T value; ///< Somma degli spostamenti in sospeso degli antenati.
+
+    shift_offset() : value() {}
+
+    explicit shift_offset(const T& value) : value(value) {}
+
+    /**
+     * @brief Spostamento dei figli di un nodo che ha questo spostamento.
+     */
+    template<typename Node>
+    shift_offset below(const Node* node) const {
+        return shift_offset(wrapping_add(value, node->pending));
+    }
+
+    /**
+     * @brief Spostamento del padre di un nodo che ha questo spostamento.
+     *
+     * Esatto solo per chiavi intere: in virgola mobile la sottrazione non
+     * annulla sempre la somma fatta da below.
+     */
+    template<typename Node>
+    shift_offset above(const Node* parent) const {
+        return shift_offset(wrapping_sub(value, parent->pending));
+    }
+
+    /**
+     * @brief Chiave effettiva di un nodo con questo spostamento.
+     */
+    T key(const T& data) const {
+        return wrapping_add(data, value);
+    }
+};
+
+/**
+ * @brief Per i tipi senza spostamento pigro le chiavi memorizzate sono già quelle effettive.
+ */
+template<typename T>
+struct shift_offset<T, false> {
+    typedef const T& reference; ///< Tipo della chiave letta: la chiave del nodo.
+
+    template<typename Node>
+    shift_offset below(const Node*) const {
+        return *this;
+    }
+
+    template<typename Node>
+    shift_offset above(const Node*) const {
+        return *this;
+    }
+
+    const T& key(const T& data) const {
+        return data;
+    }
+};
+
+/**
+ * @brief Statistiche di una discesa passate alle sonde USDT.
+ * 
+ * Senza BINARYTREE_USDT i contatori non esistono e gli aggiornamenti sono vuoti.
+ */
+struct probe_stats {
+#ifdef BINARYTREE_USDT
+    unsigned long depth = 0; ///< Nodi visitati.
+    unsigned long comparisons = 0; ///< Chiamate a compare ed equal.
+
+    void visit() { depth++; }
+    void compared(unsigned long n) { comparisons += n; }
+#else
+    void visit() {}
+    void compared(unsigned long) {}
+#endif
+};
+
+} // namespace binarytree_detail
+
+/**
+ * @brief Risultato di un'operazione che produce un valore oppure un codice di errore.
+ * 
+ * Ricalca l'interfaccia essenziale di std::expected<V, TreeError>.
+ * 
+ * @tparam V Tipo del valore prodotto.
+ */
+template<typename V>
+class TreeResult {
 private:
+    std::optional<V> result; ///< Valore prodotto, assente in caso di errore.
+    TreeError err; ///< Codice di errore (TreeError::none in caso di successo).
+
+public:
+    /**
+     * @brief Costruisce un risultato riuscito.
+     * 
+     * @param value Valore prodotto.
+     */
+    TreeResult(V&& value) : result(std::move(value)), err(TreeError::none) {}
+
+    /**
+     * @brief Costruisce un risultato fallito.
+     * 
+     * @param error Codice di errore.
+     */
+    TreeResult(TreeError error) : err(error) {}
+
+    /**
+     * @brief Verifica se l'operazione è riuscita.
+     * 
+     * @return true Se il risultato contiene un valore.
+     * @return false Altrimenti.
+     */
+    bool has_value() const {
+        return result.has_value();
+    }
+
+    /**
+     * @brief Conversione a bool equivalente a has_value().
+     */
+    explicit operator bool() const {
+        return has_value();
+    }
+
+    /**
+     * @brief Restituisce il codice di errore.
+     * 
+     * @return TreeError Codice di errore (TreeError::none in caso di successo).
+     */
+    TreeError error() const {
+        return err;
+    }
+
+    /**
+     * @brief Restituisce il valore, segnalando l'errore se assente.
+     * 
+     * @return V& Valore prodotto.
+     */
+    V& value() {
+        if (!result) {
+            binarytree_detail::raise(err);
+        }
+        return *result;
+    }
+
+    /**
+     * @brief Accesso al valore (deve essere presente).
+     * 
+     * @return V& Valore prodotto.
+     */
+    V& operator*() {
+        return *result;
+    }
+
+    /**
+     * @brief Accesso ai membri del valore (deve essere presente).
+     * 
+     * @return V* Puntatore al valore prodotto.
+     */
+    V* operator->() {
+        return &*result;
+    }
+};
+
+/**
+ * @brief Colonna di stringhe esportata da export_columns.
+ * 
+ * Le stringhe sono concatenate in un unico buffer: la i-esima occupa
+ * [offsets[i], offsets[i + 1]), quindi offsets ha size() + 1 elementi.
+ */
+struct StringColumn {
+    std::vector<size_t> offsets; ///< Inizio di ogni stringa nel buffer, più la fine dell'ultima.
+    std::string buffer; ///< Caratteri di tutte le stringhe, senza separatori.
+
+    /**
+     * @brief Restituisce il numero di stringhe.
+     */
+    size_t size() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    /**
+     * @brief Restituisce la i-esima stringa (valida finché la colonna non cambia).
+     */
+    std::string_view operator[](size_t i) const {
+        return std::string_view(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+namespace binarytree_detail {
+
+/**
+ * @brief Tipo del campo restituito da un estrattore applicato a un elemento.
+ */
+template<typename T, typename Extractor>
+using field_t = typename std::decay<typename std::invoke_result<const Extractor&, const T&>::type>::type;
+
+/**
+ * @brief Colonna di un campo aritmetico: un vettore indicizzato per posizione in ordine.
+ * 
+ * Ogni thread scrive direttamente nelle proprie posizioni, quindi i
+ * frammenti non contengono dati.
+ */
+template<typename R, typename = void>
+struct column_traits {
+    static_assert(std::is_arithmetic<R>::value, "export_columns supports arithmetic and string fields.");
+
+    typedef std::vector<R> column; ///< Colonna esportata.
+    struct chunk {}; ///< Dati di un tratto contiguo scritti da un thread.
+
+    static void resize(column& c, size_t n) {
+        c.resize(n);
+    }
+
+    static void put(column& c, chunk&, size_t rank, R value) {
+        c[rank] = value;
+    }
+
+    static void link(column&) {}
+
+    static void place(column&, size_t, chunk&) {}
+};
+
+/**
+ * @brief Colonna di un campo bool, memorizzata come std::vector<uint8_t>.
+ *
+ * std::vector<bool> impacchetta più elementi in una parola, quindi i thread
+ * di export_columns_parallel che scrivono posizioni adiacenti toccherebbero
+ * la stessa memoria.
+ */
+template<>
+struct column_traits<bool> {
+    typedef std::vector<uint8_t> column; ///< Colonna esportata (0 o 1 per elemento).
+    struct chunk {}; ///< Dati di un tratto contiguo scritti da un thread.
+
+    static void resize(column& c, size_t n) {
+        c.resize(n);
+    }
+
+    static void put(column& c, chunk&, size_t rank, bool value) {
+        c[rank] = value ? 1 : 0;
+    }
+
+    static void link(column&) {}
+
+    static void place(column&, size_t, chunk&) {}
+};
+
+/**
+ * @brief Colonna di un campo stringa: lunghezze scritte per posizione,
+ * caratteri accumulati per tratto e copiati nel buffer alla fine.
+ */
+template<typename R>
+struct column_traits<R, typename std::enable_if<std::is_convertible<const R&, std::string_view>::value>::type> {
+    typedef StringColumn column; ///< Colonna esportata.
+    typedef std::string chunk; ///< Caratteri di un tratto contiguo scritti da un thread.
+
+    static void resize(column& c, size_t n) {
+        c.offsets.assign(n + 1, 0);
+        c.buffer.clear();
+    }
+
+    static void put(column& c, chunk& bytes, size_t rank, std::string_view value) {
+        c.offsets[rank + 1] = value.size();
+        bytes.append(value);
+    }
+
+    /**
+     * @brief Trasforma le lunghezze in offset e dimensiona il buffer.
+     */
+    static void link(column& c) {
+        for (size_t i = 1; i < c.offsets.size(); ++i) {
+            c.offsets[i] += c.offsets[i - 1];
+        }
+        c.buffer.resize(c.offsets.back());
+    }
+
+    /**
+     * @brief Copia nel buffer i caratteri del tratto che inizia alla posizione first.
+     */
+    static void place(column& c, size_t first, chunk& bytes) {
+        if (bytes.size() == c.buffer.size()) {
+            c.buffer.swap(bytes); // Un solo tratto: nessuna copia.
+        } else {
+            std::copy(bytes.begin(), bytes.end(), c.buffer.begin() + c.offsets[first]);
+        }
+    }
+};
+
+/**
+ * @brief Colonna esportata per il campo estratto da Extractor.
+ */
+template<typename T, typename Extractor>
+using column_t = typename column_traits<field_t<T, Extractor> >::column;
+
+} // namespace binarytree_detail
+
+#if __cplusplus >= 202002L && __has_include(<ranges>)
+#include <ranges>
+#define BINARYTREE_HAS_RANGES 1
+#endif
+
+/**
+ * @def BINARYTREE_TRACE_SCOPE
+ * @brief Registra la durata del blocco corrente con il nome dato (vedi tree_trace.hpp).
+ * 
+ * Attivo solo se BINARYTREE_TRACE è definita; altrimenti non genera codice.
+ */
+#ifdef BINARYTREE_TRACE
+#include "tree_trace.hpp"
+#define BINARYTREE_TRACE_SCOPE(name) binarytree_trace::scope binarytree_trace_scope_(name)
+#else
+#define BINARYTREE_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#ifdef BINARYTREE_CHECKPOINTS
+#include "tree_checkpoint.hpp"
+#endif
+
+/**
+ * @def BINARYTREE_PROBE
+ * @brief Sonda statica USDT (provider "binarytree") osservabile con bpftrace.
+ * 
+ * Attiva solo se BINARYTREE_USDT è definita e <sys/sdt.h> (systemtap-sdt-dev)
+ * è disponibile: ogni sonda è un'istruzione nop finché nessuno vi si collega,
+ * ma la discesa conta profondità e confronti per passarli come argomenti.
+ * Negli altri casi gli argomenti non vengono valutati.
+ * 
+ * Sonde e argomenti:
+ * - insert_entry(nodi), insert_return(profondità, confronti, TreeError, nodi);
+ * - exists_entry(nodi), exists_return(profondità, confronti, trovato);
+ * - subtree_entry(nodi), subtree_return(profondità, confronti, nodi copiati);
+ * - copy_entry(nodi sorgente), copy_return(nodi);
+ * - destroy_entry(nodi), destroy_return(nodi) nel distruttore;
+ * - iterator_entry(non vuoto), iterator_return(profondità) per begin().
+ * 
+ * Esempio: bpftrace -e 'usdt:./main.exe:binarytree:exists_return { @depth = hist(arg0); }'
+ */
+#if defined(BINARYTREE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BINARYTREE_PROBE(name, ...) STAP_PROBEV(binarytree, name, __VA_ARGS__)
+#endif
+#endif
+#ifndef BINARYTREE_PROBE
+#define BINARYTREE_PROBE(name, ...) ((void)0)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BINARYTREE_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define BINARYTREE_PREFETCH(ptr) ((void)0)
+#endif
+
+/**
+ * @brief Classe template per un albero binario.
+ * 
+ * Ogni nodo memorizza la dimensione del proprio sottoalbero, così cursori e
+ * operazioni per rango la leggono in O(1). Definendo
+ * BINARYTREE_NO_SUBTREE_SIZES prima di includere l'header il campo viene
+ * omesso (un size_t in meno per nodo) e le dimensioni vengono ricalcolate
+ * visitando il sottoalbero quando servono.
+ * 
+ * Con BINARYTREE_LAZY_SHIFT, per chiavi aritmetiche ogni nodo porta anche
+ * uno spostamento in sospeso per i sottoalberi dei figli (vedi shift): le
+ * discese che modificano l'albero lo applicano ai figli, quelle const lo
+ * sommano lungo il cammino senza scrivere nei nodi.
+ * 
+ * @tparam T Tipo dei dati contenuti nel nodo dell'albero.
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ */
+template<typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
+class BinaryTree {
+private:
+    /**
+     * @brief Struttura per rappresentare un nodo dell'albero.
+     */
+    struct Node : binarytree_detail::shift_tag<T> {
+        T data; ///< Dato contenuto nel nodo.
+        Node* left; ///< Puntatore al nodo figlio sinistro.
+        Node* right; ///< Puntatore al nodo figlio destro.
+        Node* parent; ///< Puntatore al nodo padre (nullptr per la radice).
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+        size_t size; ///< Numero di nodi nel sottoalbero radicato in questo nodo.
+#endif
+#ifdef BINARYTREE_CHECKPOINTS
+        bool dirty; ///< Nodo o discendenti modificati dopo l'ultimo checkpoint.
+        uint64_t persist_ref; ///< Record dell'ultimo checkpoint che contiene il nodo (0 se nessuno).
+#endif
+
+        /**
+         * @brief Costruttore di Node.
+         * 
+         * @param value Valore da assegnare al nodo.
+         * @param parent Nodo padre del nuovo nodo.
+         */
+        Node(const T& value, Node* parent = nullptr) : data(value), left(nullptr), right(nullptr), parent(parent)
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+            , size(1)
+#endif
+#ifdef BINARYTREE_CHECKPOINTS
+            , dirty(true), persist_ref(0)
+#endif
+        {}
+    };
+
+    /**
+     * @brief Restituisce il numero di nodi del sottoalbero radicato in un nodo.
+     * 
+     * @param node Radice del sottoalbero (può essere nullptr).
+     * @return size_t Numero di nodi; O(1) con le dimensioni dei sottoalberi, altrimenti O(k).
+     */
+    static size_t subtree_size(const Node* node) {
+        if (!node) {
+            return 0;
+        }
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+        return node->size;
+#else
+        return 1 + subtree_size(node->left) + subtree_size(node->right);
+#endif
+    }
+
+    /**
+     * @brief Ricalcola la dimensione di un nodo da quelle dei figli.
+     * 
+     * @param node Nodo da aggiornare (non nullptr).
+     */
+    static void update_size(Node* node) {
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+        node->size = 1 + subtree_size(node->left) + subtree_size(node->right);
+#else
+        (void)node;
+#endif
+    }
+
+    /**
+     * @brief Sposta la chiave di un nodo e ne rimanda lo spostamento ai figli.
+     * 
+     * @param node Radice del sottoalbero da spostare (può essere nullptr).
+     * @param delta Spostamento da aggiungere a tutte le chiavi del sottoalbero.
+     */
+    static void apply_shift(Node* node, const T& delta) {
+        if (node) {
+            node->data = binarytree_detail::wrapping_add(node->data, delta);
+            node->pending = binarytree_detail::wrapping_add(node->pending, delta);
+#ifdef BINARYTREE_CHECKPOINTS
+            node->persist_shift = binarytree_detail::wrapping_add(node->persist_shift, delta);
+#endif
+        }
+    }
+
+    /**
+     * @brief Segna un nodo e i suoi antenati come da riscrivere al prossimo checkpoint.
+     * 
+     * Un nodo sporco ha sempre il padre sporco, quindi la risalita si ferma
+     * al primo antenato già segnato. Senza BINARYTREE_CHECKPOINTS non fa nulla.
+     * 
+     * @param node Nodo modificato (può essere nullptr).
+     */
+    static void mark_dirty(Node* node) {
+#ifdef BINARYTREE_CHECKPOINTS
+        for (; node && !node->dirty; node = node->parent) {
+            node->dirty = true;
+        }
+#else
+        (void)node;
+#endif
+    }
+
+    /**
+     * @brief Applica ai figli lo spostamento in sospeso di un nodo.
+     * 
+     * La usano solo i metodi che modificano l'albero, prima di scendere in un
+     * figlio: così la chiave di ogni nodo raggiunto da una discesa dalla
+     * radice è aggiornata. I metodi const accumulano invece lo spostamento
+     * in un offset_type (vedi node_offset).
+     * 
+     * @param node Nodo da cui scendere (non nullptr).
+     */
+    static void push_down(Node* node) {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            if (node->pending != T()) {
+                apply_shift(node->left, node->pending);
+                apply_shift(node->right, node->pending);
+                node->pending = T();
+            }
+        } else {
+            (void)node;
+        }
+    }
+
+    typedef binarytree_detail::shift_offset<T> offset_type; ///< Spostamento ereditato dagli antenati.
+    typedef typename offset_type::reference key_reference; ///< Chiave letta: const T&, o una copia con lo spostamento pigro.
+
+    /**
+     * @brief Calcola dalla radice lo spostamento ereditato da un nodo.
+     * 
+     * @param node Nodo dell'albero (non nullptr).
+     * @return offset_type Somma degli spostamenti in sospeso dei suoi antenati.
+     */
+    static offset_type node_offset(const Node* node) {
+        if (!node->parent) {
+            return offset_type();
+        }
+        return node_offset(node->parent).below(node->parent);
+    }
+
+    /**
+     * @brief Ricava lo spostamento di un antenato da quello di un discendente.
+     * 
+     * Costo pari alla risalita; con chiavi in virgola mobile, se un nodo
+     * attraversato ha uno spostamento in sospeso, viene ricalcolato dalla
+     * radice, così il risultato coincide bit per bit con quello di una discesa.
+     * 
+     * @param node Nodo di partenza.
+     * @param offset Spostamento di node.
+     * @param ancestor Antenato di node (non nullptr).
+     * @return offset_type Spostamento di ancestor.
+     */
+    static offset_type ancestor_offset(const Node* node, offset_type offset, const Node* ancestor) {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            for (; node != ancestor; node = node->parent) {
+                if (node->parent->pending != T()) {
+                    if constexpr (!std::is_integral<T>::value) {
+                        return node_offset(ancestor);
+                    }
+                    offset = offset.above(node->parent);
+                }
+            }
+        } else {
+            (void)node;
+            (void)ancestor;
+        }
+        return offset;
+    }
+
+    /**
+     * @brief Applica a un nodo staccato dai suoi antenati lo spostamento ereditato.
+     * 
+     * @param node Radice del sottoalbero (non nullptr).
+     * @param offset Spostamento ereditato dal nodo.
+     */
+    static void apply_offset(Node* node, const offset_type& offset) {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            if (offset.value != T()) {
+                apply_shift(node, offset.value);
+            }
+        } else {
+            (void)node;
+            (void)offset;
+        }
+    }
+
+    /**
+     * @brief Voce della cache dei primi livelli: chiave e nodo corrispondente.
+     * 
+     * Una posizione vuota ripete la voce del padre: una discesa che vi entra
+     * prosegue sempre nella stessa direzione e alla fine lascia la cache dal
+     * figlio mancante di quel nodo, senza controlli a ogni livello.
+     */
+    struct top_entry {
+        T key; ///< Copia della chiave del nodo.
+        Node* node; ///< Nodo (quello del padre se la posizione è vuota, nullptr se l'albero è vuoto).
+    };
+
+    Node* root; ///< Radice dell'albero.
+    Compare compare; ///< Functore per confrontare i dati.
+    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
+    size_t node_count; ///< Numero di nodi nell'albero.
+    std::vector<top_entry> top; ///< Primi livelli in ordine di visita in ampiezza (vuoto se disattivata).
+    binarytree_detail::shift_budget<T> pending_budget; ///< Spostamenti pigri in virgola mobile contati dall'ultimo flush_shifts.
+#ifdef BINARYTREE_CHECKPOINTS
+    std::string checkpoint_dir; ///< Directory dell'ultimo checkpoint scritto o ripristinato (vuota se nessuno).
+    uint64_t checkpoint_seq = 0; ///< Numero di quel checkpoint.
+    uint64_t checkpoint_records = 0; ///< Record nella catena di segmenti di quel checkpoint.
+#endif
+
+    /**
+     * @brief Ricostruisce la cache dei primi livelli dai nodi dell'albero.
+     * 
+     * La posizione i ha i figli in 2i + 1 e 2i + 2. Gli spostamenti in
+     * sospeso dei nodi in cache vengono applicati ai figli, così la cache
+     * resta valida finché la forma dell'albero non cambia: le chiavi dei nodi
+     * in cache non vengono più toccate da push_down e una discesa può
+     * proseguire dai figli dell'ultimo livello senza altri aggiornamenti.
+     * Costo O(2^livelli), senza allocazioni.
+     */
+    void rebuild_top_cache() {
+        for (size_t i = 0; i < top.size(); ++i) {
+            Node* node = root;
+            if (i > 0) {
+                size_t parent = (i - 1) / 2;
+                node = !top_slot_filled(parent) ? nullptr : (i & 1) ? top[parent].node->left : top[parent].node->right;
+            }
+            if (node) {
+                push_down(node);
+                top[i].key = node->data;
+                top[i].node = node;
+            } else if (i > 0) {
+                top[i] = top[(i - 1) / 2];
+            } else {
+                top[i] = top_entry{T(), nullptr};
+            }
+        }
+    }
+
+    /**
+     * @brief Vero se la posizione della cache corrisponde a un nodo dell'albero.
+     */
+    bool top_slot_filled(size_t i) const {
+        return i == 0 ? top[0].node != nullptr : top[i].node != top[(i - 1) / 2].node;
+    }
+
+    /**
+     * @brief Copia la voce di una posizione in tutte quelle sotto di essa.
+     * 
+     * Serve quando un inserimento riempie una posizione vuota: le posizioni
+     * sotto il nuovo nodo sono vuote e ne ripetono la voce. Costo
+     * O(2^(livelli - profondità)).
+     */
+    void fill_top_below(size_t slot) {
+        for (size_t first = 2 * slot + 1, count = 2; first < top.size(); first = 2 * first + 1, count *= 2) {
+            for (size_t i = first; i < first + count && i < top.size(); ++i) {
+                top[i] = top[slot];
+            }
+        }
+    }
+
+    /**
+     * @brief Alloca un nodo senza lanciare eccezioni in caso di memoria esaurita.
+     * 
+     * @param value Valore da assegnare al nodo.
+     * @param parent Nodo padre del nuovo nodo.
+     * @return Node* Nuovo nodo, oppure nullptr se l'allocazione fallisce.
+     */
+    static Node* create_node(const T& value, Node* parent) {
+        return new (std::nothrow) Node(value, parent);
+    }
+
+    /**
+     * @brief Inserisce un valore nell'albero riportando l'esito con un codice.
+     * 
+     * Scende iterativamente fino alla posizione libera; l'albero viene
+     * modificato solo se il valore non è presente e l'allocazione riesce.
+     * 
+     * @param value Valore da inserire nell'albero.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
+     */
+    TreeError insert_node(const T& value) {
+        BINARYTREE_TRACE_SCOPE("insert");
+        BINARYTREE_PROBE(insert_entry, node_count);
+        binarytree_detail::probe_stats stats;
+        TreeError err = link_new_node(value, stats);
+        BINARYTREE_PROBE(insert_return, stats.depth, stats.comparisons, static_cast<int>(err), node_count);
+        return err;
+    }
+
+    /**
+     * @brief Corpo di insert_node: discesa e collegamento del nuovo nodo.
+     * 
+     * @param value Valore da inserire nell'albero.
+     * @param stats Statistiche della discesa.
+     * @param linked Se non nullptr, riceve il nuovo nodo in caso di successo.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
+     */
+    TreeError link_new_node(const T& value, binarytree_detail::probe_stats& stats, Node** linked = nullptr) {
+        Node* parent = nullptr;
+        Node** link = &root;
+        size_t slot = 0; // Posizione di *link nella cache dei primi livelli.
+        while (*link) {
+            Node* node = *link;
+            stats.visit();
+            stats.compared(2);
+            if (equal(value, node->data)) {
+                shrink_path(parent, 1);
+                return TreeError::duplicate;
+            }
+            push_down(node);
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+            node->size++; // Durante la discesa il nodo è già in cache; annullato sui percorsi di errore.
+#endif
+            parent = node;
+            bool go_left = compare(value, node->data);
+            link = go_left ? &node->left : &node->right;
+            if (slot < top.size()) {
+                slot = 2 * slot + (go_left ? 1 : 2);
+            }
+        }
+        Node* node = create_node(value, parent);
+        if (!node) {
+            shrink_path(parent, 1);
+            return TreeError::out_of_memory;
+        }
+        *link = node;
+        node_count++;
+        pending_budget.note_key(value);
+        mark_dirty(parent);
+        if (slot < top.size()) {
+            top[slot].key = node->data;
+            top[slot].node = node;
+            fill_top_below(slot);
+        }
+        if (linked) {
+            *linked = node;
+        }
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Sottrae count alla dimensione di un nodo e di tutti i suoi antenati.
+     * 
+     * @param node Nodo più profondo del cammino (può essere nullptr).
+     * @param count Nodi tolti dal sottoalbero.
+     */
+    static void shrink_path(Node* node, size_t count) {
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+        for (; node; node = node->parent) {
+            node->size -= count;
+        }
+#else
+        (void)node;
+        (void)count;
+#endif
+    }
+
+    /**
+     * @brief Annulla gli inserimenti registrati in un log, dal più recente.
+     * 
+     * Un nodo appena inserito è una foglia e resta tale finché non vengono
+     * annullati gli inserimenti successivi, quindi basta staccarlo dal padre
+     * e aggiornare le dimensioni degli antenati. Costo O(k * altezza) per k
+     * nodi, indipendente dalla dimensione dell'albero.
+     * 
+     * @param undo Nodi inseriti, in ordine di inserimento (nullptr ignorati); viene svuotato.
+     */
+    void rollback(std::vector<Node*>& undo) {
+        bool changed = false;
+        while (!undo.empty()) {
+            Node* node = undo.back();
+            undo.pop_back();
+            if (!node) {
+                continue;
+            }
+            Node* parent = node->parent;
+            if (!parent) {
+                root = nullptr;
+            } else if (parent->left == node) {
+                parent->left = nullptr;
+            } else {
+                parent->right = nullptr;
+            }
+            shrink_path(parent, 1);
+            mark_dirty(parent);
+            node_count--;
+            delete node;
+            changed = true;
+        }
+        if (changed) {
+            rebuild_top_cache();
+        }
+    }
+
+    /**
+     * @brief Cerca il nodo che contiene un valore.
+     * 
+     * I nodi in cache non hanno spostamenti in sospeso, quindi la discesa
+     * riparte dai loro figli con spostamento nullo. Nella cache si fa un
+     * confronto per livello e non si legge nessun nodo, tranne quello da cui
+     * la discesa prosegue nell'albero.
+     * 
+     * @param value Valore da cercare.
+     * @param stats Statistiche della discesa.
+     * @param found_offset Se non nullptr, riceve lo spostamento ereditato dal nodo trovato.
+     * @return Node* Nodo contenente il valore, se trovato; altrimenti nullptr.
+     */
+    Node* find_node(const T& value, binarytree_detail::probe_stats& stats, offset_type* found_offset = nullptr) const {
+        Node* node = root;
+        if (!top.empty() && root) {
+            // Un solo confronto per livello: candidate è l'ultima chiave in
+            // cache non minore di value, l'unica che può esserle uguale.
+            const top_entry* entries = top.data();
+            const size_t slots = top.size();
+            size_t i = 0;
+            size_t last = 0;
+            size_t candidate = slots;
+            bool go_left = false;
+            while (i < slots) {
+                stats.visit();
+                stats.compared(1);
+                last = i;
+                go_left = !compare(entries[i].key, value);
+                if (go_left) {
+                    candidate = i;
+                    i = 2 * i + 1;
+                } else {
+                    i = 2 * i + 2;
+                }
+            }
+            if (candidate < slots) {
+                stats.compared(1);
+                if (equal(entries[candidate].key, value)) {
+                    if (found_offset) {
+                        *found_offset = offset_type();
+                    }
+                    return entries[candidate].node;
+                }
+            }
+            node = go_left ? entries[last].node->left : entries[last].node->right;
+        }
+        offset_type offset;
+        while (node) {
+            stats.visit();
+            stats.compared(1);
+            key_reference key = offset.key(node->data);
+            if (equal(key, value)) {
+                if (found_offset) {
+                    *found_offset = offset;
+                }
+                return node;
+            }
+            stats.compared(1);
+            offset = offset.below(node);
+            node = compare(value, key) ? node->left : node->right;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Stampa in ordine (in-order traversal) l'albero a partire da un nodo dato.
+     * 
+     * @param node Nodo corrente da cui iniziare la stampa.
+     * @param os Stream di output su cui stampare.
+     * @param offset Spostamento ereditato dal nodo.
+     */
+    void print_in_order(Node* node, std::ostream& os, offset_type offset = offset_type()) const {
+        if (!node) {
+            return;
+        }
+        offset_type below = offset.below(node);
+        print_in_order(node->left, os, below);
+        os << offset.key(node->data) << " ";
+        print_in_order(node->right, os, below);
+    }
+
+    /**
+     * @brief Distrugge ricorsivamente l'intero albero a partire da un nodo dato.
+     * 
+     * @param node Nodo corrente da cui iniziare la distruzione.
+     */
+    static void destroy_tree(Node* node) {
+        binarytree_detail::destroy_subtree(node);
+    }
+
+    /**
+     * @brief Copia ricorsivamente un sottoalbero a partire da un nodo sorgente.
+     * 
+     * Se un'allocazione fallisce la copia parziale resta collegata a dest,
+     * così il chiamante può liberarla con destroy_tree.
+     * 
+     * @param dest Radice del sottoalbero di destinazione.
+     * @param src Radice del sottoalbero sorgente da copiare.
+     * @param parent Padre da assegnare alla radice copiata.
+     * @return true Se la copia è completa.
+     * @return false Se un'allocazione è fallita.
+     */
+    bool copy_subtree(Node*& dest, Node* src, Node* parent = nullptr) const {
+        if (!src) {
+            return true;
+        }
+        auto clone = [](const Node* from, Node* to_parent) {
+            Node* node = create_node(from->data, to_parent);
+            if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+                if (node) {
+                    node->pending = from->pending;
+                }
+            }
+            return node;
+        };
+        auto finish = [](Node* node) { update_size(node); };
+        return binarytree_detail::copy_subtree(dest, src, parent, clone, finish);
+    }
+
+    /**
+     * @brief Copia l'intero albero sorgente in una nuova radice.
+     * 
+     * @param src Radice da copiare.
+     * @param dest Radice della copia (nullptr in caso di errore).
+     * @return TreeError TreeError::none oppure out_of_memory.
+     */
+    TreeError copy_tree(Node* src, Node*& dest) const {
+        dest = nullptr;
+        if (!copy_subtree(dest, src)) {
+            destroy_tree(dest);
+            dest = nullptr;
+            return TreeError::out_of_memory;
+        }
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Costruisce ricorsivamente un sottoalbero bilanciato da una sequenza ordinata.
+     * 
+     * Il nodo centrale dell'intervallo diventa la radice, così l'altezza resta
+     * logaritmica anche quando l'input è già ordinato. Se un'allocazione
+     * fallisce il sottoalbero corrispondente resta vuoto: il chiamante lo
+     * riconosce perché node_count non raggiunge il numero di valori.
+     * 
+     * @param sorted Valori ordinati secondo compare e privi di duplicati.
+     * @param lo Indice del primo elemento dell'intervallo.
+     * @param hi Indice successivo all'ultimo elemento dell'intervallo.
+     * @param parent Padre da assegnare alla radice del sottoalbero.
+     * @return Node* Radice del sottoalbero costruito.
+     */
+    Node* build_balanced(const std::vector<T>& sorted, size_t lo, size_t hi, Node* parent = nullptr) {
+        auto split = [](size_t first, size_t last, size_t) { return first + (last - first) / 2; };
+        auto make = [this, &sorted](size_t index, Node* node_parent) {
+            Node* node = create_node(sorted[index], node_parent);
+            if (node) {
+                node_count++;
+                pending_budget.note_key(sorted[index]);
+            }
+            return node;
+        };
+        auto finish = [](Node* node) { update_size(node); };
+        return binarytree_detail::build_subtree(lo, hi, 0, parent, split, make, finish);
+    }
+
+    /**
+     * @brief Ricollega nodi esistenti in un sottoalbero bilanciato.
+     * 
+     * Come build_balanced, ma riusa i nodi invece di allocarne di nuovi.
+     * 
+     * @param nodes Nodi in ordine secondo compare.
+     * @param lo Indice del primo nodo dell'intervallo.
+     * @param hi Indice successivo all'ultimo nodo dell'intervallo.
+     * @param parent Padre da assegnare alla radice del sottoalbero.
+     * @return Node* Radice del sottoalbero ricollegato.
+     */
+    static Node* relink_balanced(const std::vector<Node*>& nodes, size_t lo, size_t hi, Node* parent) {
+        if (lo >= hi) {
+            return nullptr;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = nodes[mid];
+        node->parent = parent;
+        node->left = relink_balanced(nodes, lo, mid, node);
+        node->right = relink_balanced(nodes, mid + 1, hi, node);
+        update_size(node);
+#ifdef BINARYTREE_CHECKPOINTS
+        node->dirty = true;
+#endif
+        return node;
+    }
+
+    /**
+     * @brief Cerca ricorsivamente un blocco di valori ordinati condividendo le discese.
+     * 
+     * A ogni nodo le query vengono partizionate in minori, uguali e maggiori, così
+     * i prefissi comuni dei cammini vengono percorsi una sola volta.
+     * 
+     * @param node Nodo corrente.
+     * @param first Prima query del blocco (ordinato secondo compare).
+     * @param last Fine del blocco di query.
+     * @param result Primo esito corrispondente a first.
+     * @param offset Spostamento ereditato dal nodo.
+     */
+    template<typename RandomIt, typename OutputIt>
+    void exists_sorted(Node* node, RandomIt first, RandomIt last, OutputIt result, offset_type offset = offset_type()) const {
+        if (first == last) {
+            return;
+        }
+        if (!node) {
+            std::fill_n(result, last - first, false);
+            return;
+        }
+        key_reference key = offset.key(node->data);
+        offset = offset.below(node);
+        RandomIt lower = std::partition_point(first, last, [&](const T& q) {
+            return !equal(q, key) && compare(q, key);
+        });
+        RandomIt upper = std::partition_point(lower, last, [&](const T& q) {
+            return equal(q, key);
+        });
+        exists_sorted(node->left, first, lower, result, offset);
+        std::fill_n(result + (lower - first), upper - lower, true);
+        exists_sorted(node->right, upper, last, result + (upper - first), offset);
+    }
+
+    /**
+     * @brief Scollega un sottoalbero e lo consegna a un nuovo albero.
+     * 
+     * @param node Radice del sottoalbero (nullptr per nessuno).
+     * @param offset Spostamento ereditato dal nodo, applicato alla radice staccata.
+     * @return BinaryTree Albero che possiede il sottoalbero.
+     */
+    BinaryTree detach(Node* node, const offset_type& offset)
+    {
+        BINARYTREE_TRACE_SCOPE("detach_subtree");
+        BinaryTree detached(compare, equal);
+        if (!node) {
+            return detached;
+        }
+        detached.enable_top_cache(top_cache_levels()); // Allocata prima di modificare questo albero.
+        size_t count = subtree_size(node);
+        Node* parent = node->parent;
+        if (!parent) {
+            root = nullptr;
+        } else if (parent->left == node) {
+            parent->left = nullptr;
+        } else {
+            parent->right = nullptr;
+        }
+        shrink_path(parent, count);
+        mark_dirty(parent);
+        node->parent = nullptr;
+        apply_offset(node, offset);
+        node_count -= count;
+        detached.root = node;
+        detached.node_count = count;
+        detached.pending_budget = pending_budget; // Le etichette staccate sono somme degli stessi spostamenti.
+        detached.rebuild_top_cache();
+        rebuild_top_cache();
+        return detached;
+    }
+
+    /**
+     * @brief Sposta le chiavi in [lo, hi] etichettando i sottoalberi interamente compresi.
+     * 
+     * Corpo di try_shift con BINARYTREE_LAZY_SHIFT, dopo le verifiche:
+     * l'intervallo non è vuoto. Costo O(altezza).
+     * 
+     * @param lo Estremo inferiore dell'intervallo (incluso).
+     * @param hi Estremo superiore dell'intervallo (incluso).
+     * @param delta Spostamento da aggiungere.
+     */
+    void tag_shift(const T& lo, const T& hi, const T& delta) {
+        // Primo nodo del cammino dalla radice con chiave nell'intervallo.
+        Node* split = root;
+        while (compare(split->data, lo) || compare(hi, split->data)) {
+            push_down(split);
+            split = compare(split->data, lo) ? split->right : split->left;
+        }
+        push_down(split);
+        split->data += delta;
+        mark_dirty(split);
+        // A sinistra: ogni nodo >= lo è spostato insieme al suo sottoalbero destro.
+        for (Node* node = split->left; node; ) {
+            push_down(node);
+            if (compare(node->data, lo)) {
+                node = node->right;
+            } else {
+                node->data += delta;
+                mark_dirty(node);
+                apply_shift(node->right, delta);
+                node = node->left;
+            }
+        }
+        // A destra: ogni nodo <= hi è spostato insieme al suo sottoalbero sinistro.
+        for (Node* node = split->right; node; ) {
+            push_down(node);
+            if (compare(hi, node->data)) {
+                node = node->left;
+            } else {
+                node->data += delta;
+                mark_dirty(node);
+                apply_shift(node->left, delta);
+                node = node->right;
+            }
+        }
+    }
+
+    /**
+     * @brief Verifica che le somme di uno spostamento pigro siano esatte e lo conta.
+     * 
+     * Per chiavi intere basta la verifica dei bordi di try_shift. In virgola
+     * mobile le chiavi spostate e ogni somma di etichette devono restare su
+     * una griglia di potenze di due rappresentabile senza arrotondamenti
+     * (vedi binarytree_detail::shift_budget). Costo O(1).
+     * 
+     * @param first Prima chiave dell'intervallo.
+     * @param back Ultima chiave dell'intervallo.
+     * @param delta Spostamento da aggiungere.
+     * @return true Se si può etichettare: lo spostamento è stato contato.
+     * @return false Se qualche somma potrebbe arrotondare (nulla è cambiato).
+     */
+    bool reserve_tag_shift(const T& first, const T& back, const T& delta) {
+        if constexpr (std::is_floating_point<T>::value) {
+            // Le chiavi sono monotone: quella di modulo massimo è a un estremo.
+            return pending_budget.reserve(delta, std::max(std::fabs(first), std::fabs(back)));
+        } else {
+            (void)first;
+            (void)back;
+            (void)delta;
+            return true;
+        }
+    }
+
+#ifdef BINARYTREE_CHECKPOINTS
+    static constexpr size_t checkpoint_shift_size = binarytree_detail::has_lazy_shift<T>::value ? sizeof(T) : 0; ///< Byte di uno spostamento nei record.
+    static constexpr size_t checkpoint_edge_size = sizeof(uint64_t) + checkpoint_shift_size; ///< Byte di un riferimento a un nodo.
+    static constexpr size_t checkpoint_record_size = sizeof(T) + checkpoint_shift_size + 2 * checkpoint_edge_size; ///< Byte di un record di nodo.
+
+    /**
+     * @brief Stato di persistenza di un nodo prima che un checkpoint lo riscriva.
+     */
+    struct checkpoint_undo {
+        Node* node; ///< Nodo riscritto.
+        uint64_t ref; ///< Record precedente.
+        binarytree_detail::shift_tag<T> tag; ///< Spostamenti precedenti.
+    };
+
+    /**
+     * @brief Accoda il riferimento al record corrente di un nodo.
+     * 
+     * @param out Buffer del record.
+     * @param node Nodo referenziato (nullptr per nessuno).
+     */
+    static void put_checkpoint_edge(std::vector<unsigned char>& out, const Node* node) {
+        binarytree_checkpoint::put(out, node ? node->persist_ref : uint64_t(0));
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            binarytree_checkpoint::put(out, node ? node->persist_shift : T());
+        }
+    }
+
+    /**
+     * @brief Scrive in post-ordine i record dei nodi da riscrivere di un sottoalbero.
+     * 
+     * Un nodo pulito che ha già un record non viene visitato: il padre lo
+     * referenzia insieme allo spostamento ricevuto dopo la scrittura. Le
+     * chiavi e gli spostamenti in sospeso vengono scritti così come sono,
+     * senza applicarli ai figli.
+     * 
+     * @param node Radice del sottoalbero.
+     * @param full Se vero riscrive tutti i nodi.
+     * @param seq Numero del segmento in scrittura.
+     * @param writer Segmento in scrittura.
+     * @param undo Se non nullptr, riceve lo stato precedente dei nodi riscritti.
+     */
+    static void write_checkpoint_subtree(Node* node, bool full, uint64_t seq, binarytree_checkpoint::segment_writer& writer,
+                                         std::vector<checkpoint_undo>* undo) {
+        if (!node || !(full || node->dirty || !node->persist_ref)) {
+            return;
+        }
+        write_checkpoint_subtree(node->left, full, seq, writer, undo);
+        write_checkpoint_subtree(node->right, full, seq, writer, undo);
+        if (undo) {
+            undo->push_back(checkpoint_undo{node, node->persist_ref, *node});
+        }
+        std::vector<unsigned char>& out = writer.record();
+        binarytree_checkpoint::put(out, node->data);
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            binarytree_checkpoint::put(out, node->pending);
+        }
+        put_checkpoint_edge(out, node->left);
+        put_checkpoint_edge(out, node->right);
+        node->persist_ref = binarytree_checkpoint::make_ref(seq, writer.commit());
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            node->persist_shift = T();
+        }
+    }
+
+    /**
+     * @brief Ripristina i riferimenti dei nodi riscritti da un checkpoint fallito.
+     * 
+     * @param undo Stato precedente dei nodi riscritti.
+     */
+    static void undo_checkpoint(const std::vector<checkpoint_undo>& undo) {
+        for (size_t i = 0; i < undo.size(); ++i) {
+            undo[i].node->persist_ref = undo[i].ref;
+            static_cast<binarytree_detail::shift_tag<T>&>(*undo[i].node) = undo[i].tag;
+        }
+    }
+
+    /**
+     * @brief Segna come puliti i nodi sporchi di un sottoalbero (tutti appena scritti).
+     * 
+     * @param node Radice del sottoalbero.
+     */
+    static void clear_dirty(Node* node) {
+        if (node && node->dirty) {
+            node->dirty = false;
+            clear_dirty(node->left);
+            clear_dirty(node->right);
+        }
+    }
+
+    /**
+     * @brief Ricostruisce ricorsivamente il sottoalbero referenziato da un riferimento.
+     * 
+     * I figli sono scritti prima del padre, quindi un riferimento valido è
+     * sempre minore di quello del record che lo contiene: un checkpoint
+     * danneggiato non può creare cicli.
+     * 
+     * @param dest Nodo ricostruito (nullptr per un riferimento vuoto).
+     * @param parent Padre del nodo.
+     * @param pos Riferimento codificato; viene fatto avanzare.
+     * @param bound Riferimento del record che lo contiene.
+     * @param m MANIFEST del checkpoint.
+     * @param segments Record dei segmenti, nell'ordine di m.segments.
+     * @return TreeError TreeError::none, out_of_memory oppure io_error.
+     */
+    TreeError restore_checkpoint_edge(Node*& dest, Node* parent, const unsigned char*& pos, uint64_t bound,
+                                      const binarytree_checkpoint::manifest& m,
+                                      const std::vector<std::vector<unsigned char> >& segments) {
+        dest = nullptr;
+        uint64_t ref = binarytree_checkpoint::get<uint64_t>(pos);
+        T shift = T();
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            shift = binarytree_checkpoint::get<T>(pos);
+        }
+        if (!ref) {
+            return TreeError::none;
+        }
+        uint64_t seq = binarytree_checkpoint::ref_segment(ref);
+        uint64_t index = binarytree_checkpoint::ref_index(ref);
+        std::vector<binarytree_checkpoint::segment_info>::const_iterator segment = std::lower_bound(
+            m.segments.begin(), m.segments.end(), seq,
+            [](const binarytree_checkpoint::segment_info& info, uint64_t s) { return info.seq < s; });
+        if (ref >= bound || segment == m.segments.end() || segment->seq != seq || index >= segment->records ||
+            node_count >= m.count) {
+            return TreeError::io_error;
+        }
+        const unsigned char* record = segments[segment - m.segments.begin()].data() + index * checkpoint_record_size;
+        dest = create_node(binarytree_checkpoint::get<T>(record), parent);
+        if (!dest) {
+            return TreeError::out_of_memory;
+        }
+        node_count++;
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            dest->pending = binarytree_checkpoint::get<T>(record);
+            pending_budget.absorb(dest->pending);
+            pending_budget.absorb(shift);
+            dest->data = binarytree_detail::wrapping_add(dest->data, shift);
+            dest->pending = binarytree_detail::wrapping_add(dest->pending, shift);
+            dest->persist_shift = shift;
+        }
+        pending_budget.note_key(dest->data);
+        dest->persist_ref = ref;
+        dest->dirty = false;
+        TreeError err = restore_checkpoint_edge(dest->left, dest, record, ref, m, segments);
+        if (err == TreeError::none) {
+            err = restore_checkpoint_edge(dest->right, dest, record, ref, m, segments);
+        }
+        update_size(dest);
+        return err;
+    }
+#endif
+
+    /**
+     * @brief Conta ricorsivamente gli elementi di un sottoalbero per intervallo.
+     * 
+     * I confini del blocco sono quelli che possono cadere dentro il
+     * sottoalbero: se non ce ne sono, l'intero sottoalbero appartiene a un
+     * solo intervallo e viene contato con subtree_size (O(1) con le
+     * dimensioni dei sottoalberi). Altrimenti i confini vengono partizionati
+     * attorno alla chiave del nodo come in exists_sorted. Nei primi
+     * spawn_depth livelli il sottoalbero sinistro viene contato da un altro
+     * thread in un vettore separato.
+     * 
+     * @param node Radice del sottoalbero.
+     * @param first Primo confine del blocco.
+     * @param last Fine del blocco di confini.
+     * @param bucket Intervallo delle chiavi minori di *first.
+     * @param counts Conteggi per intervallo da incrementare.
+     * @param buckets Numero di intervalli.
+     * @param spawn_depth Livelli in cui dividere il lavoro tra thread.
+     * @param offset Spostamento ereditato dal nodo.
+     */
+    template<typename RandomIt>
+    void histogram_subtree(Node* node, RandomIt first, RandomIt last, size_t bucket, size_t* counts,
+                           size_t buckets, unsigned spawn_depth, offset_type offset = offset_type()) const {
+        if (!node) {
+            return;
+        }
+        if (first == last) {
+            counts[bucket] += subtree_size(node);
+            return;
+        }
+        key_reference key = offset.key(node->data);
+        offset = offset.below(node);
+        RandomIt pos = std::partition_point(first, last, [&](const T& b) {
+            return !compare(key, b);
+        });
+        size_t middle = bucket + (pos - first);
+        counts[middle]++;
+        if (spawn_depth > 0 && node->left && node->right) {
+            std::vector<size_t> local(buckets, 0);
+            std::thread worker([&]() {
+                histogram_subtree(node->left, first, pos, bucket, local.data(), buckets, spawn_depth - 1, offset);
+            });
+            histogram_subtree(node->right, pos, last, middle, counts, buckets, spawn_depth - 1, offset);
+            worker.join();
+            for (size_t i = bucket; i <= middle; ++i) {
+                counts[i] += local[i];
+            }
+            return;
+        }
+        histogram_subtree(node->left, first, pos, bucket, counts, buckets, 0, offset);
+        histogram_subtree(node->right, pos, last, middle, counts, buckets, 0, offset);
+    }
+
+    /**
+     * @brief Trait della colonna dell'I-esimo estrattore di una tupla.
+     */
+    template<size_t I, typename Extractors>
+    using column_traits_at = binarytree_detail::column_traits<
+        binarytree_detail::field_t<T, typename std::tuple_element<I, Extractors>::type> >;
+
+    /**
+     * @brief Nodo in attesa sulla pila di scan_subtree, con il suo spostamento ereditato.
+     * 
+     * Lo spostamento è una base, così senza spostamento pigro la voce
+     * occupa solo il puntatore.
+     */
+    struct scan_entry : offset_type {
+        Node* node; ///< Nodo da visitare.
+
+        scan_entry(Node* node, const offset_type& offset) : offset_type(offset), node(node) {}
+    };
+
+    /**
+     * @brief Visita in ordine un sottoalbero con una pila esplicita (vedi scan).
+     * 
+     * La funzione riceve il nodo e lo spostamento che eredita (la chiave
+     * effettiva è offset.key(node->data)); gli spostamenti dei figli sono
+     * già calcolati, quindi può azzerare lo spostamento in sospeso del nodo.
+     * 
+     * @param node Radice del sottoalbero.
+     * @param f Funzione da applicare a ogni nodo, invocata con (Node*, const offset_type&).
+     * @param prefetch_distance Nodi in attesa di anticipo rispetto alla visita corrente.
+     * @param offset Spostamento ereditato dalla radice del sottoalbero.
+     */
+    template<typename Function>
+    static void scan_subtree(Node* node, Function& f, size_t prefetch_distance, offset_type offset = offset_type()) {
+        std::vector<scan_entry> stack;
+        stack.reserve(64);
+        while (node || !stack.empty()) {
+            while (node) {
+                if (prefetch_distance) {
+                    BINARYTREE_PREFETCH(node->right);
+                }
+                stack.push_back(scan_entry(node, offset));
+                offset = offset.below(node);
+                node = node->left;
+            }
+            Node* visited = stack.back().node;
+            offset_type visited_offset = stack.back();
+            stack.pop_back();
+            if (prefetch_distance && stack.size() >= prefetch_distance) {
+                Node* ahead = stack[stack.size() - prefetch_distance].node->right;
+                if (ahead) {
+                    BINARYTREE_PREFETCH(ahead->left);
+                    BINARYTREE_PREFETCH(ahead->right);
+                }
+            }
+            node = visited->right;
+            offset = visited_offset.below(visited);
+            f(visited, static_cast<const offset_type&>(visited_offset));
+        }
+    }
+
+    /**
+     * @brief Chiave raccolta da select_subtree: puntatore alla chiave del nodo, o una copia con lo spostamento pigro.
+     */
+    typedef typename std::conditional<binarytree_detail::has_lazy_shift<T>::value, T, const T*>::type selected_key;
+
+    /**
+     * @brief Converte una chiave letta nella forma raccolta da select_subtree.
+     */
+    static selected_key select_key(key_reference key) {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            return key;
+        } else {
+            return &key;
+        }
+    }
+
+    /**
+     * @brief Restituisce il valore di una chiave raccolta da select_subtree.
+     */
+    static const T& selected_value(const selected_key& key) {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            return key;
+        } else {
+            return *key;
+        }
+    }
+
+    /**
+     * @brief Raccoglie in ordine gli elementi di un sottoalbero che soddisfano un predicato.
+     * 
+     * Nei primi spawn_depth livelli il sottoalbero sinistro viene visitato da
+     * un altro thread in un vettore separato, poi concatenato; il resto
+     * viene visitato con scan_subtree.
+     * 
+     * @param node Radice del sottoalbero.
+     * @param pred Predicato, invocato con const T& (anche da più thread insieme).
+     * @param selected Riceve in coda le chiavi selezionate, in ordine.
+     * @param spawn_depth Livelli in cui dividere il lavoro tra thread.
+     * @param offset Spostamento ereditato dalla radice del sottoalbero.
+     */
+    template<typename Predicate>
+    static void select_subtree(Node* node, Predicate& pred, std::vector<selected_key>& selected, unsigned spawn_depth,
+                               offset_type offset = offset_type()) {
+        if (!node) {
+            return;
+        }
+        if (spawn_depth > 0 && node->left && node->right) {
+            offset_type below = offset.below(node);
+            std::vector<selected_key> left_selected;
+            std::thread worker([&]() {
+                select_subtree(node->left, pred, left_selected, spawn_depth - 1, below);
+            });
+            std::vector<selected_key> right_selected;
+            key_reference key = offset.key(node->data);
+            if (pred(static_cast<const T&>(key))) {
+                right_selected.push_back(select_key(key));
+            }
+            select_subtree(node->right, pred, right_selected, spawn_depth - 1, below);
+            worker.join();
+            selected.insert(selected.end(), left_selected.begin(), left_selected.end());
+            selected.insert(selected.end(), right_selected.begin(), right_selected.end());
+            return;
+        }
+        auto visit = [&](Node* visited, const offset_type& visited_offset) {
+            key_reference key = visited_offset.key(visited->data);
+            if (pred(static_cast<const T&>(key))) {
+                selected.push_back(select_key(key));
+            }
+        };
+        scan_subtree(node, visit, 4, offset);
+    }
+
+    /**
+     * @brief Costruisce un sottoalbero bilanciato copiando chiavi già ordinate.
+     * 
+     * Come build_balanced, ma legge le chiavi raccolte da select_subtree e nei primi
+     * spawn_depth livelli costruisce il sottoalbero sinistro in un altro
+     * thread. Se un'allocazione fallisce il sottoalbero corrispondente resta
+     * vuoto e ok diventa falso.
+     * 
+     * @param keys Chiavi raccolte da select_subtree, in ordine secondo compare e distinte.
+     * @param lo Indice del primo elemento dell'intervallo.
+     * @param hi Indice successivo all'ultimo elemento dell'intervallo.
+     * @param parent Padre da assegnare alla radice del sottoalbero.
+     * @param spawn_depth Livelli in cui dividere il lavoro tra thread.
+     * @param ok Posto a false se un'allocazione fallisce.
+     * @return Node* Radice del sottoalbero costruito.
+     */
+    static Node* copy_balanced(const std::vector<selected_key>& keys, size_t lo, size_t hi, Node* parent,
+                               unsigned spawn_depth, bool& ok) {
+        if (lo >= hi) {
+            return nullptr;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = create_node(selected_value(keys[mid]), parent);
+        if (!node) {
+            ok = false;
+            return nullptr;
+        }
+        if (spawn_depth > 0 && lo < mid && mid + 1 < hi) {
+            bool left_ok = true;
+            std::thread worker([&]() {
+                node->left = copy_balanced(keys, lo, mid, node, spawn_depth - 1, left_ok);
+            });
+            node->right = copy_balanced(keys, mid + 1, hi, node, spawn_depth - 1, ok);
+            worker.join();
+            ok = ok && left_ok;
+        } else {
+            node->left = copy_balanced(keys, lo, mid, node, 0, ok);
+            node->right = copy_balanced(keys, mid + 1, hi, node, 0, ok);
+        }
+        update_size(node);
+        return node;
+    }
+
+    /**
+     * @brief Scrive i campi di un elemento nelle colonne alla sua posizione in ordine.
+     * 
+     * @param data Elemento.
+     * @param rank Posizione in ordine dell'elemento.
+     * @param columns Colonne di destinazione.
+     * @param chunks Frammenti del tratto corrente.
+     * @param extractors Estrattori dei campi.
+     */
+    template<typename Columns, typename Chunks, typename Extractors, size_t... I>
+    static void export_element(const T& data, size_t rank, Columns& columns, Chunks& chunks,
+                               const Extractors& extractors, std::index_sequence<I...>) {
+        (column_traits_at<I, Extractors>::put(std::get<I>(columns), std::get<I>(chunks), rank, std::get<I>(extractors)(data)), ...);
+    }
+
+    /**
+     * @brief Esporta ricorsivamente un sottoalbero nelle colonne.
+     * 
+     * Le posizioni in ordine derivano dalle dimensioni dei sottoalberi, quindi
+     * i thread scrivono in parti disgiunte delle colonne. Nei primi
+     * spawn_depth livelli il sottoalbero sinistro viene esportato da un altro
+     * thread; il resto viene visitato con scan_subtree. Ogni visita
+     * sequenziale produce un tratto (posizione iniziale e frammenti), e i
+     * tratti vengono aggiunti a segments in ordine.
+     * 
+     * @param node Radice del sottoalbero.
+     * @param rank Posizione in ordine del primo elemento del sottoalbero.
+     * @param columns Colonne di destinazione, già dimensionate.
+     * @param segments Tratti prodotti, in ordine.
+     * @param extractors Estrattori dei campi.
+     * @param spawn_depth Livelli in cui dividere il lavoro tra thread.
+     * @param offset Spostamento ereditato dalla radice del sottoalbero.
+     */
+    template<typename Columns, typename Chunks, typename Extractors>
+    void export_subtree(Node* node, size_t rank, Columns& columns, std::vector<std::pair<size_t, Chunks> >& segments,
+                        const Extractors& extractors, unsigned spawn_depth, offset_type offset = offset_type()) const {
+        typedef std::make_index_sequence<std::tuple_size<Extractors>::value> indices;
+        if (!node) {
+            return;
+        }
+        if (spawn_depth > 0 && node->left && node->right) {
+            offset_type below = offset.below(node);
+            size_t node_rank = rank + subtree_size(node->left);
+            std::vector<std::pair<size_t, Chunks> > left_segments;
+            std::thread worker([&]() {
+                export_subtree(node->left, rank, columns, left_segments, extractors, spawn_depth - 1, below);
+            });
+            std::vector<std::pair<size_t, Chunks> > right_segments;
+            right_segments.emplace_back(node_rank, Chunks());
+            export_element(offset.key(node->data), node_rank, columns, right_segments.back().second, extractors, indices());
+            export_subtree(node->right, node_rank + 1, columns, right_segments, extractors, spawn_depth - 1, below);
+            worker.join();
+            std::move(left_segments.begin(), left_segments.end(), std::back_inserter(segments));
+            std::move(right_segments.begin(), right_segments.end(), std::back_inserter(segments));
+            return;
+        }
+        segments.emplace_back(rank, Chunks());
+        Chunks& chunks = segments.back().second;
+        size_t next = rank;
+        auto visit = [&](Node* visited, const offset_type& visited_offset) {
+            export_element(visited_offset.key(visited->data), next++, columns, chunks, extractors, indices());
+        };
+        scan_subtree(node, visit, 4, offset);
+    }
+
+    /**
+     * @brief Dimensiona le colonne per n elementi.
+     */
+    template<typename Extractors, typename Columns, size_t... I>
+    static void resize_columns(Columns& columns, size_t n, std::index_sequence<I...>) {
+        (column_traits_at<I, Extractors>::resize(std::get<I>(columns), n), ...);
+    }
+
+    /**
+     * @brief Completa le colonne copiando i frammenti dei tratti al loro posto.
+     * 
+     * @param columns Colonne esportate.
+     * @param segments Tratti prodotti da export_subtree, in ordine.
+     */
+    template<typename Extractors, typename Columns, typename Chunks, size_t... I>
+    static void link_columns(Columns& columns, std::vector<std::pair<size_t, Chunks> >& segments, std::index_sequence<I...>) {
+        (column_traits_at<I, Extractors>::link(std::get<I>(columns)), ...);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            (column_traits_at<I, Extractors>::place(std::get<I>(columns), segments[i].first, std::get<I>(segments[i].second)), ...);
+        }
+    }
+
+public:
+    /**
+     * @brief Costruttore di default per creare un albero vuoto.
+     */
+    BinaryTree() : root(nullptr), node_count(0) {}
+
+    /**
+     * @brief Costruttore per creare un albero vuoto con functori specifici.
+     * 
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    explicit BinaryTree(Compare comp, Equal eq = Equal()) : root(nullptr), compare(comp), equal(eq), node_count(0) {}
+
+    /**
+     * @brief Costruttore che crea un albero a partire da una sequenza di elementi.
+     * 
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    template<typename InputIt>
+    BinaryTree(InputIt first, InputIt last, Compare comp = Compare(), Equal eq = Equal())
+        : root(nullptr), compare(comp), equal(eq), node_count(0) {
+        apply_batch(first, last);
+    }
+
+    /**
+     * @brief Costruisce un albero bilanciato a partire da una sequenza di elementi.
+     * 
+     * Gli elementi vengono ordinati una sola volta e poi collegati in O(n) prendendo
+     * ricorsivamente il mediano come radice; se la sequenza è già ordinata
+     * l'ordinamento viene saltato. Per chiavi intere o in virgola mobile con
+     * l'ordinamento di default (std::less) si usa radix_sort, parallelo sulle
+     * sequenze grandi, invece di un ordinamento per confronti.
+     * A differenza del costruttore da intervallo
+     * l'albero risultante ha altezza logaritmica anche per input ordinati.
+     * 
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * @return BinaryTree Albero bilanciato contenente gli elementi.
+     * @throw std::runtime_error Se la sequenza contiene duplicati.
+     */
+    template<typename InputIt>
+    static BinaryTree bulk_build(InputIt first, InputIt last, Compare comp = Compare(), Equal eq = Equal()) {
+        TreeResult<BinaryTree> tree = try_bulk_build(first, last, comp, eq);
+        BINARYTREE_TRY {
+            return std::move(tree.value());
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di bulk_build che riporta gli errori con un codice.
+     * 
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * @return TreeResult<BinaryTree> Albero bilanciato, oppure TreeError::duplicate o out_of_memory.
+     */
+    template<typename InputIt>
+    static TreeResult<BinaryTree> try_bulk_build(InputIt first, InputIt last, Compare comp = Compare(), Equal eq = Equal()) {
+        BINARYTREE_TRACE_SCOPE("bulk_build");
+        BinaryTree tree(comp, eq);
+        std::vector<T> values(first, last);
+        if (!std::is_sorted(values.begin(), values.end(), comp)) {
+            if constexpr (uses_radix_sort<T, Compare>::value) {
+                radix_sort(values);
+            } else {
+                std::sort(values.begin(), values.end(), comp);
+            }
+        }
+        for (size_t i = 1; i < values.size(); ++i) {
+            if (eq(values[i - 1], values[i])) {
+                return TreeError::duplicate;
+            }
+        }
+        tree.root = tree.build_balanced(values, 0, values.size());
+        if (tree.node_count != values.size()) {
+            return TreeError::out_of_memory; // Il distruttore di tree libera la costruzione parziale.
+        }
+        return tree;
+    }
+
+    /**
+     * @brief Costruttore di copia per creare un albero identico a un altro.
+     * 
+     * @param other Altro oggetto BinaryTree da cui copiare.
+     */
+    BinaryTree(const BinaryTree& other) : root(nullptr), compare(other.compare), equal(other.equal), node_count(0) {
+        BINARYTREE_TRACE_SCOPE("copy");
+        BINARYTREE_PROBE(copy_entry, other.node_count);
+        BINARYTREE_TRY {
+            TreeError err = copy_tree(other.root, root);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+            node_count = other.node_count;
+            pending_budget = other.pending_budget;
+            enable_top_cache(other.top_cache_levels());
+        } BINARYTREE_CATCH_CLEANUP(destroy_tree(root)) // Il distruttore non viene chiamato se il costruttore lancia.
+        BINARYTREE_PROBE(copy_return, node_count);
+    }
+
+    /**
+     * @brief Operatore di assegnazione per copiare un albero in un altro.
+     * 
+     * @param other Altro oggetto BinaryTree da cui copiare.
+     * @return BinaryTree& Referenza a se stesso dopo l'assegnazione.
+     */
+    BinaryTree& operator=(const BinaryTree& other) {
+        BINARYTREE_TRY {
+            TreeError err = try_assign(other);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
+        return *this;
+    }
+
+    /**
+     * @brief Variante dell'assegnazione per copia che riporta gli errori con un codice.
+     * 
+     * La copia viene costruita prima di liberare i nodi correnti: se
+     * l'allocazione fallisce l'albero resta invariato.
+     * 
+     * @param other Altro oggetto BinaryTree da cui copiare.
+     * @return TreeError TreeError::none oppure out_of_memory.
+     */
+    TreeError try_assign(const BinaryTree& other) {
+        BINARYTREE_TRACE_SCOPE("assign");
+        if (this == &other) {
+            return TreeError::none;
+        }
+        Node* copy = nullptr;
+        TreeError err = copy_tree(other.root, copy);
+        if (err != TreeError::none) {
+            return err;
+        }
+        std::vector<top_entry> entries;
+        BINARYTREE_TRY {
+            entries.assign(other.top.size(), top_entry{T(), nullptr});
+        } BINARYTREE_CATCH_CLEANUP(destroy_tree(copy))
+        destroy_tree(root);
+        root = copy;
+        node_count = other.node_count;
+        compare = other.compare;
+        equal = other.equal;
+        pending_budget = other.pending_budget;
+        top.swap(entries); // Come per la copia, la configurazione della cache è quella di other.
+        rebuild_top_cache();
+#ifdef BINARYTREE_CHECKPOINTS
+        checkpoint_dir.clear(); // Nessun nodo ha un record: il prossimo checkpoint è completo.
+#endif
+        return TreeError::none;
+    }
+
     /**
-     * @brief Struttura per rappresentare un nodo dell'albero.
+     * @brief Costruttore di spostamento che acquisisce i nodi di un altro albero.
+     * 
+     * @param other Albero da cui spostare i nodi, lasciato vuoto.
      */
-    struct Node {
-        T data; ///< Dato contenuto nel nodo.
-        Node* left; ///< Puntatore al nodo figlio sinistro.
-        Node* right; ///< Puntatore al nodo figlio destro.
+    BinaryTree(BinaryTree&& other) noexcept
+        : root(other.root), compare(other.compare), equal(other.equal), node_count(other.node_count),
+          top(std::move(other.top)), pending_budget(other.pending_budget) {
+        other.root = nullptr;
+        other.node_count = 0;
+        other.top.clear();
+        other.pending_budget.reset();
+#ifdef BINARYTREE_CHECKPOINTS
+        checkpoint_dir.swap(other.checkpoint_dir);
+        checkpoint_seq = other.checkpoint_seq;
+        checkpoint_records = other.checkpoint_records;
+#endif
+    }
 
-        /**
-         * @brief Costruttore di Node.
-         * 
-         * @param value Valore da assegnare al nodo.
-         */
-        Node(const T& value) : data(value), left(nullptr), right(nullptr) {}
-    };
+    /**
+     * @brief Operatore di assegnazione per spostamento.
+     * 
+     * @param other Albero da cui spostare i nodi, lasciato vuoto.
+     * @return BinaryTree& Referenza a se stesso dopo l'assegnazione.
+     */
+    BinaryTree& operator=(BinaryTree&& other) noexcept {
+        if (this != &other) {
+            destroy_tree(root);
+            root = other.root;
+            node_count = other.node_count;
+            compare = other.compare;
+            equal = other.equal;
+            top = std::move(other.top);
+            pending_budget = other.pending_budget;
+            other.root = nullptr;
+            other.node_count = 0;
+            other.top.clear();
+            other.pending_budget.reset();
+#ifdef BINARYTREE_CHECKPOINTS
+            checkpoint_dir.swap(other.checkpoint_dir);
+            other.checkpoint_dir.clear();
+            checkpoint_seq = other.checkpoint_seq;
+            checkpoint_records = other.checkpoint_records;
+#endif
+        }
+        return *this;
+    }
 
-    Node* root; ///< Radice dell'albero.
-    Compare compare; ///< Functore per confrontare i dati.
-    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
-    size_t node_count; ///< Numero di nodi nell'albero.
+    /**
+     * @brief Distruttore che libera la memoria dell'albero.
+     */
+    ~BinaryTree() {
+        BINARYTREE_TRACE_SCOPE("destroy");
+        BINARYTREE_PROBE(destroy_entry, node_count);
+        destroy_tree(root);
+        BINARYTREE_PROBE(destroy_return, node_count);
+    }
 
     /**
-     * @brief Funzione ricorsiva per l'inserimento di un nodo nell'albero.
+     * @brief Inserisce un nuovo valore nell'albero.
      * 
-     * @param node Nodo corrente in cui inserire il valore.
-     * @param value Valore da inserire nell'albero.
-     * @return Node* Nodo radice aggiornato dopo l'inserimento.
+     * @param value Valore da inserire.
      * @throw std::runtime_error Se il valore duplicato viene inserito.
      */
-    Node* insert(Node* node, const T& value) {
-        if (!node) {
-            node_count++;
-            return new Node(value);
-        }
-        if (equal(value, node->data)) {
-            throw std::runtime_error("Duplicate element insertion is not allowed.");
-        } else if (compare(value, node->data)) {
-            node->left = insert(node->left, value);
-        } else {
-            node->right = insert(node->right, value);
-        }
-        return node;
+    void insert(const T& value) {
+        BINARYTREE_TRY {
+            TreeError err = insert_node(value);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
     }
 
     /**
-     * @brief Funzione ricorsiva per verificare se un valore esiste nell'albero.
+     * @brief Inserisce un nuovo valore riportando l'esito con un codice.
      * 
-     * @param node Nodo corrente da cui iniziare la ricerca.
-     * @param value Valore da cercare.
-     * @return true Se il valore esiste nell'albero.
-     * @return false Altrimenti.
+     * Non usa eccezioni: è la variante da preferire nei percorsi critici e
+     * nelle build senza eccezioni.
+     * 
+     * @param value Valore da inserire.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
      */
-    bool exists(Node* node, const T& value) const {
-        if (!node) {
-            return false;
-        }
-        if (equal(node->data, value)) {
-            return true;
-        }
-        if (compare(value, node->data)) {
-            return exists(node->left, value);
-        } else {
-            return exists(node->right, value);
-        }
+    TreeError try_insert(const T& value) {
+        return insert_node(value);
     }
 
     /**
-     * @brief Trova il sottoalbero con radice contenente un dato valore.
+     * @brief Inserisce una sequenza di valori in modo atomico.
      * 
-     * @param node Nodo corrente da cui iniziare la ricerca.
-     * @param value Valore da cercare nel sottoalbero.
-     * @return Node* Radice del sottoalbero contenente il valore, se trovato; altrimenti nullptr.
+     * O vengono inseriti tutti i valori, o l'albero resta com'era.
+     * 
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @throw std::runtime_error Se un valore è già presente o ripetuto nella sequenza.
+     * @throw std::bad_alloc Se l'allocazione di un nodo fallisce.
      */
-    Node* find_subtree(Node* node, const T& value) const {
-        if (!node) {
-            return nullptr;
-        }
-        if (equal(node->data, value)) {
-            return node;
-        }
-        if (compare(value, node->data)) {
-            return find_subtree(node->left, value);
-        } else {
-            return find_subtree(node->right, value);
+    template<typename InputIt>
+    void apply_batch(InputIt first, InputIt last) {
+        BINARYTREE_TRY {
+            TreeError err = try_apply_batch(first, last);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di apply_batch che riporta gli errori con un codice.
+     * 
+     * I nodi collegati vengono registrati in un log; al primo errore (o se
+     * compare lancia) vengono staccati solo quelli, dal più recente, senza
+     * toccare il resto dell'albero: il costo dell'annullamento dipende dalla
+     * dimensione del lotto, non da quella dell'albero.
+     * 
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
+     */
+    template<typename InputIt>
+    TreeError try_apply_batch(InputIt first, InputIt last) {
+        BINARYTREE_TRACE_SCOPE("apply_batch");
+        std::vector<Node*> undo;
+        if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                      typename std::iterator_traits<InputIt>::iterator_category>::value) {
+            undo.reserve(static_cast<size_t>(std::distance(first, last)));
         }
+        BINARYTREE_TRY {
+            for (; first != last; ++first) {
+                // Lo spazio nel log viene riservato prima di collegare il nodo.
+                undo.push_back(nullptr);
+                binarytree_detail::probe_stats stats;
+                TreeError err = link_new_node(*first, stats, &undo.back());
+                if (err != TreeError::none) {
+                    rollback(undo);
+                    return err;
+                }
+            }
+        } BINARYTREE_CATCH_CLEANUP(rollback(undo))
+        return TreeError::none;
     }
 
     /**
-     * @brief Stampa in ordine (in-order traversal) l'albero a partire da un nodo dato.
+     * @brief Rimuove tutti gli elementi che soddisfano un predicato.
      * 
-     * @param node Nodo corrente da cui iniziare la stampa.
-     * @param os Stream di output su cui stampare.
+     * Una sola visita in ordine valuta il predicato su ogni nodo; solo dopo
+     * (quindi senza modifiche se il predicato lancia) i nodi rimossi vengono
+     * liberati e i superstiti ricollegati in un albero perfettamente
+     * bilanciato, senza nuove allocazioni di nodi. Costo O(n).
+     * 
+     * @tparam Predicate Tipo del predicato, invocato con const T&.
+     * @param pred Predicato che seleziona gli elementi da rimuovere.
+     * @return size_t Numero di elementi rimossi.
      */
-    void print_in_order(Node* node, std::ostream& os) const {
-        if (!node) {
-            return;
+    template<typename Predicate>
+    size_t erase_if(Predicate pred) {
+        BINARYTREE_TRACE_SCOPE("erase_if");
+        std::vector<Node*> kept;
+        std::vector<Node*> removed;
+        kept.reserve(node_count);
+        // I nodi vengono ricollegati con le chiavi effettive: gli spostamenti in sospeso si applicano prima del predicato.
+        flush_shifts();
+        auto classify = [&](Node* node, const offset_type&) {
+            if (pred(static_cast<const T&>(node->data))) {
+                removed.push_back(node);
+            } else {
+                kept.push_back(node);
+            }
+        };
+        scan_subtree(root, classify, 4);
+        for (size_t i = 0; i < removed.size(); ++i) {
+            delete removed[i];
         }
-        print_in_order(node->left, os);
-        os << node->data << " ";
-        print_in_order(node->right, os);
+        root = relink_balanced(kept, 0, kept.size(), nullptr);
+        node_count = kept.size();
+        rebuild_top_cache();
+        return removed.size();
     }
 
     /**
-     * @brief Distrugge ricorsivamente l'intero albero a partire da un nodo dato.
+     * @brief Conserva solo gli elementi che soddisfano un predicato.
      * 
-     * @param node Nodo corrente da cui iniziare la distruzione.
+     * @tparam Predicate Tipo del predicato, invocato con const T&.
+     * @param pred Predicato che seleziona gli elementi da conservare.
+     * @return size_t Numero di elementi rimossi.
      */
-    void destroy_tree(Node* node) {
-        if (!node) {
-            return;
+    template<typename Predicate>
+    size_t retain_if(Predicate pred) {
+        return erase_if([&pred](const T& value) { return !pred(value); });
+    }
+
+    /**
+     * @brief Crea un nuovo albero bilanciato con gli elementi che soddisfano un predicato.
+     * 
+     * A differenza del costruttore da intervallo su un'iterazione filtrata,
+     * che reinserisce ogni elemento con una discesa completa e, dato che
+     * l'input è ordinato, produce un albero degenere, qui una sola visita in
+     * ordine valuta il predicato e il risultato viene costruito bilanciato
+     * in O(n) prendendo ricorsivamente il mediano come radice, senza
+     * confronti. L'albero di partenza non viene modificato.
+     * 
+     * Con threads > 1 i sottoalberi dei primi livelli vengono visitati e le
+     * metà del risultato costruite in parallelo: il predicato deve allora
+     * poter essere invocato da più thread insieme.
+     * 
+     * @tparam Predicate Tipo del predicato, invocato con const T&.
+     * @param pred Predicato che seleziona gli elementi da copiare.
+     * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+     * @return BinaryTree Albero bilanciato con gli elementi selezionati.
+     * @throw std::bad_alloc Se l'allocazione dei nodi fallisce.
+     */
+    template<typename Predicate>
+    BinaryTree copy_if(Predicate pred, unsigned threads = 1) const {
+        TreeResult<BinaryTree> tree = try_copy_if(pred, threads);
+        BINARYTREE_TRY {
+            return std::move(tree.value());
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di copy_if che riporta gli errori con un codice.
+     * 
+     * @tparam Predicate Tipo del predicato, invocato con const T&.
+     * @param pred Predicato che seleziona gli elementi da copiare.
+     * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+     * @return TreeResult<BinaryTree> Albero bilanciato, oppure TreeError::out_of_memory.
+     */
+    template<typename Predicate>
+    TreeResult<BinaryTree> try_copy_if(Predicate pred, unsigned threads = 1) const {
+        BINARYTREE_TRACE_SCOPE("copy_if");
+        unsigned spawn_depth = binarytree_detail::spawn_depth(threads);
+        std::vector<selected_key> selected;
+        select_subtree(root, pred, selected, spawn_depth);
+        BinaryTree tree(compare, equal);
+        bool ok = true;
+        tree.root = copy_balanced(selected, 0, selected.size(), nullptr, spawn_depth, ok);
+        if (!ok) {
+            return TreeError::out_of_memory; // Il distruttore di tree libera la costruzione parziale.
         }
-        destroy_tree(node->left);
-        destroy_tree(node->right);
-        delete node;
+        tree.node_count = selected.size();
+        tree.pending_budget = pending_budget; // Chiavi selezionate da questo albero.
+        tree.enable_top_cache(top_cache_levels());
+        return tree;
     }
 
     /**
-     * @brief Copia ricorsivamente un sottoalbero a partire da un nodo sorgente.
+     * @brief Aggiunge uno spostamento a tutte le chiavi comprese in [lo, hi].
      * 
-     * @param dest Radice del sottoalbero di destinazione.
-     * @param src Radice del sottoalbero sorgente da copiare.
+     * Di norma le chiavi comprese vengono aggiornate una per una, in
+     * O(k + altezza) per k chiavi spostate. Definendo BINARYTREE_LAZY_SHIFT
+     * prima di includere l'header il costo diventa O(altezza): le chiavi dei
+     * nodi sui due cammini di confine vengono aggiornate subito, mentre i
+     * sottoalberi interamente compresi nell'intervallo ricevono solo
+     * un'etichetta. Le discese che modificano l'albero la applicano ai figli;
+     * i metodi const sommano invece le etichette incontrate lungo la discesa
+     * senza scrivere nei nodi, quindi restano utilizzabili da più thread
+     * insieme, ma ogni lettura paga una somma per livello e gli iteratori
+     * restituiscono copie delle chiavi.
+     * 
+     * Sono ammessi solo spostamenti che mantengono l'ordine: le chiavi
+     * spostate non devono raggiungere né superare quelle adiacenti esterne
+     * all'intervallo. Compare deve essere coerente con l'ordine numerico
+     * (crescente o decrescente). Anche le chiavi spostate devono essere
+     * rappresentabili in T (per la virgola mobile: finite). Con chiavi in
+     * virgola mobile l'arrotondamento può avvicinare chiavi interne: ogni
+     * coppia adiacente spostata deve restare strettamente ordinata, e lo
+     * spostamento pigro si usa solo quando tutte le somme sono esatte;
+     * altrimenti le etichette in sospeso vengono applicate (O(n)) e le
+     * chiavi spostate una per una.
+     * 
+     * @param lo Estremo inferiore dell'intervallo (incluso).
+     * @param hi Estremo superiore dell'intervallo (incluso).
+     * @param delta Spostamento da aggiungere.
+     * @throw std::runtime_error Se lo spostamento romperebbe l'ordine o traboccherebbe dal tipo delle chiavi.
      */
-    void copy_subtree(Node*& dest, Node* src) const {
-        if (!src) {
-            return;
+    void shift(const T& lo, const T& hi, const T& delta) {
+        BINARYTREE_TRY {
+            TreeError err = try_shift(lo, hi, delta);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di shift che riporta gli errori con un codice.
+     * 
+     * @param lo Estremo inferiore dell'intervallo (incluso).
+     * @param hi Estremo superiore dell'intervallo (incluso).
+     * @param delta Spostamento da aggiungere.
+     * @return TreeError TreeError::none, out_of_order oppure out_of_range (albero invariato).
+     */
+    TreeError try_shift(const T& lo, const T& hi, const T& delta) {
+        BINARYTREE_TRACE_SCOPE("shift");
+        static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                      "shift requires an arithmetic key type.");
+        if (delta == T() || compare(hi, lo)) {
+            return TreeError::none;
+        }
+        const_iterator first = lower_bound(lo);
+        const_iterator last = upper_bound(hi);
+        if (first == last) {
+            return TreeError::none;
+        }
+        const_iterator back = last;
+        --back;
+        // Le chiavi spostate sono comprese tra quelle dei due estremi.
+        T shifted_first;
+        T shifted_back;
+        if (!binarytree_detail::checked_add(static_cast<const T&>(*first), delta, shifted_first) ||
+            !binarytree_detail::checked_add(static_cast<const T&>(*back), delta, shifted_back)) {
+            return TreeError::out_of_range;
+        }
+        if (first != begin()) {
+            const_iterator before = first;
+            --before;
+            if (!compare(*before, shifted_first)) {
+                return TreeError::out_of_order;
+            }
+        }
+        if (last != end() && !compare(shifted_back, *last)) {
+            return TreeError::out_of_order;
+        }
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            if (reserve_tag_shift(*first, *back, delta)) {
+                tag_shift(lo, hi, delta);
+                rebuild_top_cache();
+                return TreeError::none;
+            }
+        }
+        if constexpr (std::is_floating_point<T>::value) {
+            // Chiavi interne più vicine dell'arrotondamento di delta diventerebbero uguali.
+            T previous = shifted_first;
+            for (const_iterator it = std::next(first); it != last; ++it) {
+                T shifted = *it + delta;
+                if (!compare(previous, shifted)) {
+                    return TreeError::out_of_order;
+                }
+                previous = shifted;
+            }
         }
-        dest = new Node(src->data);
-        if (src->left) {
-            copy_subtree(dest->left, src->left);
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            // Le etichette non basterebbero: si applicano e si torna a contarle da zero.
+            flush_shifts();
+            first = lower_bound(lo);
+            last = upper_bound(hi);
         }
-        if (src->right) {
-            copy_subtree(dest->right, src->right);
+        for (const_iterator it = first; it != last; ++it) {
+            it.current->data += delta;
+            pending_budget.note_key(it.current->data);
+            mark_dirty(it.current);
         }
+        rebuild_top_cache();
+        return TreeError::none;
     }
 
-public:
     /**
-     * @brief Costruttore di default per creare un albero vuoto.
+     * @brief Applica subito tutti gli spostamenti in sospeso.
+     * 
+     * Dopo la chiamata le letture non devono più sommare etichette finché non
+     * viene chiamato di nuovo shift. Costo O(n).
      */
-    BinaryTree() : root(nullptr), node_count(0) {}
+    void flush_shifts() {
+        if constexpr (binarytree_detail::has_lazy_shift<T>::value) {
+            auto settle = [](Node* node, const offset_type& offset) {
+                node->data = offset.key(node->data);
+#ifdef BINARYTREE_CHECKPOINTS
+                node->persist_shift = binarytree_detail::wrapping_add(node->persist_shift, offset.value);
+#endif
+                node->pending = T();
+            };
+            scan_subtree(root, settle, 0);
+#ifndef BINARYTREE_CHECKPOINTS
+            // Con i checkpoint persist_shift continua a sommare gli spostamenti applicati.
+            pending_budget.reset();
+#endif
+        }
+    }
+
+    static constexpr unsigned max_top_cache_levels = 24; ///< Livelli massimi della cache dei primi livelli.
 
     /**
-     * @brief Costruttore che crea un albero a partire da una sequenza di elementi.
+     * @brief Attiva (o disattiva, con 0) la cache contigua dei primi livelli.
      * 
-     * @tparam InputIt Tipo dell'iteratore di input.
-     * @param first Iteratore all'inizio della sequenza.
-     * @param last Iteratore alla fine della sequenza.
-     * @param comp Functore per confrontare due oggetti di tipo T.
-     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * I primi livelli dell'albero vengono visitati da ogni ricerca ma i loro
+     * nodi sono sparsi nello heap. Con la cache, chiavi e puntatori ai nodi
+     * dei primi levels livelli stanno in un array in ordine di visita in
+     * ampiezza (2^levels - 1 voci): exists, subtree e detach_subtree scendono
+     * nell'array ed entrano nell'albero solo alla profondità levels.
+     * Gli inserimenti aggiornano la cache in O(1), o in
+     * O(2^(levels - profondità)) se il nuovo nodo entra nei primi livelli
+     * (le posizioni vuote ripetono la voce del padre); erase_if, shift,
+     * detach_subtree, l'assegnazione e l'annullamento di apply_batch la
+     * ricostruiscono in O(2^levels). Valori tipici: 10-16 per alberi grandi.
+     * Finché i nodi dei primi livelli restano nella cache del processore la
+     * discesa nei nodi è veloce quanto quella nell'array (vedi i casi
+     * exists_hit ed exists_hit_top_cache di bench/regression.cpp): la cache
+     * conviene solo dove le misure lo confermano.
+     * La configurazione passa agli alberi ottenuti da questo: copia,
+     * assegnazione (per copia o spostamento), copy_if, subtree e
+     * detach_subtree usano gli stessi livelli dell'albero sorgente.
+     * 
+     * @param levels Livelli in cache (0 = cache disattivata, al più max_top_cache_levels).
+     * @throw std::bad_alloc Se l'allocazione della cache fallisce.
      */
-    template<typename InputIt>
-    BinaryTree(InputIt first, InputIt last, Compare comp = Compare(), Equal eq = Equal())
-        : root(nullptr), compare(comp), equal(eq), node_count(0) {
-        try {
-            for (InputIt it = first; it != last; ++it) {
-                insert(*it);
-            }
-        } catch (std::exception& e) {
-            destroy_tree(root);
-            throw; // Rilancia l'eccezione
+    void enable_top_cache(unsigned levels) {
+        levels = std::min(levels, max_top_cache_levels);
+        std::vector<top_entry> entries(levels ? (size_t(1) << levels) - 1 : 0, top_entry{T(), nullptr});
+        top.swap(entries);
+        rebuild_top_cache();
+    }
+
+    /**
+     * @brief Restituisce il numero di livelli nella cache dei primi livelli.
+     * 
+     * @return unsigned Livelli in cache (0 se disattivata).
+     */
+    unsigned top_cache_levels() const {
+        unsigned levels = 0;
+        while ((size_t(1) << levels) - 1 < top.size()) {
+            levels++;
         }
+        return levels;
     }
 
+#ifdef BINARYTREE_CHECKPOINTS
     /**
-     * @brief Costruttore di copia per creare un albero identico a un altro.
+     * @brief Scrive un checkpoint incrementale dell'albero in una directory.
      * 
-     * @param other Altro oggetto BinaryTree da cui copiare.
+     * Ogni modifica (inserimento, shift, erase_if, detach_subtree, ...)
+     * segna come sporchi il nodo toccato e i suoi antenati. Il checkpoint
+     * scrive in un nuovo segmento solo i record dei nodi sporchi, in
+     * post-ordine, e referenzia i record già scritti per i sottoalberi
+     * puliti; poi sostituisce atomicamente il MANIFEST (vedi
+     * tree_checkpoint.hpp). Il costo è proporzionale ai nodi modificati per
+     * l'altezza, non alla dimensione dell'albero, e senza modifiche non
+     * viene scritto nulla.
+     * 
+     * Il checkpoint è completo (un solo segmento, i precedenti vengono
+     * rimossi) se la directory non contiene un checkpoint di questo albero,
+     * se un altro processo vi ha scritto dopo, oppure se la catena supera il
+     * doppio dei nodi vivi. Se la scrittura fallisce resta valido il
+     * checkpoint precedente e le modifiche verranno riscritte dal successivo.
+     * 
+     * Visita i nodi senza applicare gli spostamenti in sospeso, quindi
+     * richiede che nessun altro thread usi l'albero durante la chiamata.
+     * 
+     * @param dir Directory del checkpoint (creata se manca).
+     * @throw std::runtime_error Se la directory o i file non possono essere scritti.
      */
-    BinaryTree(const BinaryTree& other) : root(nullptr), compare(other.compare), equal(other.equal), node_count(0) {
-        try {
-            if (other.root) {
-                copy_subtree(root, other.root);
-                node_count = other.node_count;
+    void checkpoint(const std::string& dir) {
+        BINARYTREE_TRY {
+            TreeError err = try_checkpoint(dir);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
             }
-        } catch (std::exception& e) {
-            destroy_tree(root);
-            throw; // Rilancia l'eccezione
-        }
+        } BINARYTREE_CATCH_RETHROW
     }
 
     /**
-     * @brief Operatore di assegnazione per copiare un albero in un altro.
+     * @brief Variante di checkpoint che riporta gli errori con un codice.
      * 
-     * @param other Altro oggetto BinaryTree da cui copiare.
-     * @return BinaryTree& Referenza a se stesso dopo l'assegnazione.
+     * @param dir Directory del checkpoint (creata se manca).
+     * @return TreeError TreeError::none oppure io_error.
      */
-    BinaryTree& operator=(const BinaryTree& other) {
-        if (this != &other) {
-            destroy_tree(root);
-            root = nullptr;
-            node_count = 0;
-            compare = other.compare;
-            equal = other.equal;
-            try {
-                if (other.root) {
-                    copy_subtree(root, other.root);
-                    node_count = other.node_count;
+    TreeError try_checkpoint(const std::string& dir) {
+        BINARYTREE_TRACE_SCOPE("checkpoint");
+        static_assert(std::is_trivially_copyable<T>::value, "Checkpoints require a trivially copyable type.");
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            return TreeError::io_error;
+        }
+        binarytree_checkpoint::manifest previous;
+        bool has_previous = binarytree_checkpoint::read_manifest(dir, previous);
+        bool full = !has_previous || dir != checkpoint_dir || previous.seq != checkpoint_seq ||
+                    checkpoint_records > 2 * uint64_t(node_count);
+        std::vector<unsigned char> root_edge;
+        put_checkpoint_edge(root_edge, root);
+        if (!full && !(root && root->dirty) && root_edge == previous.root) {
+            return TreeError::none;
+        }
+        uint64_t seq = has_previous ? previous.seq + 1 : 1;
+        if (seq > binarytree_checkpoint::max_segment || node_count > binarytree_checkpoint::max_records) {
+            return TreeError::io_error;
+        }
+
+        std::vector<checkpoint_undo> undo;
+        bool written = false;
+        {
+            binarytree_checkpoint::segment_writer writer(dir, seq, checkpoint_record_size);
+            // Un checkpoint completo non conserva lo stato precedente: se fallisce, il prossimo è di nuovo completo.
+            auto discard = [&]() {
+                if (full) {
+                    checkpoint_dir.clear();
+                } else {
+                    undo_checkpoint(undo);
                 }
-            } catch (std::exception& e) {
-                destroy_tree(root);
-                throw; // Rilancia l'eccezione
-            }
+                std::remove(binarytree_checkpoint::segment_path(dir, seq).c_str());
+            };
+            BINARYTREE_TRY {
+                write_checkpoint_subtree(root, full, seq, writer, full ? nullptr : &undo);
+                binarytree_checkpoint::manifest next;
+                next.elem_size = sizeof(T);
+                next.record_size = checkpoint_record_size;
+                next.seq = seq;
+                next.count = node_count;
+                put_checkpoint_edge(next.root, root);
+                if (!full) {
+                    next.segments = previous.segments;
+                }
+                uint64_t records = writer.records();
+                if (records) {
+                    next.segments.push_back(binarytree_checkpoint::segment_info{seq, records});
+                }
+                if (writer.finish() && binarytree_checkpoint::write_manifest(dir, next)) {
+                    written = true;
+                    clear_dirty(root);
+                    if (has_previous && full) {
+                        binarytree_checkpoint::remove_segments(dir, previous.segments, next.segments);
+                    }
+                    if (!records) {
+                        std::remove(binarytree_checkpoint::segment_path(dir, seq).c_str());
+                    }
+                    checkpoint_dir = dir;
+                    checkpoint_seq = seq;
+                    checkpoint_records = 0;
+                    for (size_t i = 0; i < next.segments.size(); ++i) {
+                        checkpoint_records += next.segments[i].records;
+                    }
+                } else {
+                    discard();
+                }
+            } BINARYTREE_CATCH_CLEANUP(discard())
         }
-        return *this;
+        return written ? TreeError::none : TreeError::io_error;
     }
 
     /**
-     * @brief Distruttore che libera la memoria dell'albero.
+     * @brief Ricostruisce un albero dall'ultimo checkpoint scritto in una directory.
+     * 
+     * Legge il MANIFEST e tutti i segmenti della catena, poi ricompone
+     * l'albero seguendo i riferimenti dalla radice: la forma e gli
+     * spostamenti in sospeso sono quelli dell'albero salvato. L'albero
+     * ricostruito ricorda la directory, quindi il suo prossimo checkpoint
+     * nella stessa directory è incrementale.
+     * 
+     * @param dir Directory del checkpoint.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * @return BinaryTree Albero ricostruito.
+     * @throw std::runtime_error Se il checkpoint manca, è danneggiato o non è di T.
      */
-    ~BinaryTree() {
-        destroy_tree(root);
+    static BinaryTree restore_checkpoint(const std::string& dir, Compare comp = Compare(), Equal eq = Equal()) {
+        TreeResult<BinaryTree> tree = try_restore_checkpoint(dir, comp, eq);
+        BINARYTREE_TRY {
+            return std::move(tree.value());
+        } BINARYTREE_CATCH_RETHROW
     }
 
     /**
-     * @brief Inserisce un nuovo valore nell'albero.
+     * @brief Variante di restore_checkpoint che riporta gli errori con un codice.
      * 
-     * @param value Valore da inserire.
-     * @throw std::runtime_error Se il valore duplicato viene inserito.
+     * @param dir Directory del checkpoint.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     * @return TreeResult<BinaryTree> Albero ricostruito, oppure TreeError::io_error o out_of_memory.
      */
-    void insert(const T& value) {
-        try {
-            root = insert(root, value);
-        } catch (std::exception& e) {
-            throw; // Rilancia l'eccezione
+    static TreeResult<BinaryTree> try_restore_checkpoint(const std::string& dir, Compare comp = Compare(), Equal eq = Equal()) {
+        BINARYTREE_TRACE_SCOPE("restore_checkpoint");
+        static_assert(std::is_trivially_copyable<T>::value, "Checkpoints require a trivially copyable type.");
+        binarytree_checkpoint::manifest m;
+        if (!binarytree_checkpoint::read_manifest(dir, m) || m.elem_size != sizeof(T) ||
+            m.record_size != checkpoint_record_size || m.root.size() != checkpoint_edge_size) {
+            return TreeError::io_error;
+        }
+        std::vector<std::vector<unsigned char> > segments(m.segments.size());
+        uint64_t records = 0;
+        for (size_t i = 0; i < m.segments.size(); ++i) {
+            if ((i > 0 && m.segments[i - 1].seq >= m.segments[i].seq) ||
+                !binarytree_checkpoint::read_segment(dir, m.segments[i], checkpoint_record_size, segments[i])) {
+                return TreeError::io_error;
+            }
+            records += m.segments[i].records;
+        }
+        BinaryTree tree(comp, eq);
+        const unsigned char* pos = m.root.data();
+        TreeError err = tree.restore_checkpoint_edge(tree.root, nullptr, pos, ~uint64_t(0), m, segments);
+        if (err == TreeError::none && tree.node_count != m.count) {
+            err = TreeError::io_error;
         }
+        if (err != TreeError::none) {
+            return err; // Il distruttore di tree libera la costruzione parziale.
+        }
+        tree.checkpoint_dir = dir;
+        tree.checkpoint_seq = m.seq;
+        tree.checkpoint_records = records;
+        return tree;
     }
+#endif
 
     /**
      * @brief Verifica se un valore esiste nell'albero.
@@ -251,11 +2757,55 @@ public:
      * @throw std::runtime_error Se si verifica un errore durante la ricerca.
      */
     bool exists(const T& value) const {
-        try {
-            return exists(root, value);
-        } catch (std::exception& e) {
-            throw; // Rilancia l'eccezione
-        }
+        BINARYTREE_TRACE_SCOPE("exists");
+        BINARYTREE_PROBE(exists_entry, node_count);
+        binarytree_detail::probe_stats stats;
+        BINARYTREE_TRY {
+            bool found = find_node(value, stats) != nullptr;
+            BINARYTREE_PROBE(exists_return, stats.depth, stats.comparisons, static_cast<int>(found));
+            return found;
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Verifica l'esistenza di un blocco di valori con un'unica visita condivisa.
+     * 
+     * Le query devono essere ordinate secondo il functore di confronto dell'albero;
+     * i cammini comuni a più query vengono percorsi una sola volta.
+     * 
+     * @tparam RandomIt Tipo dell'iteratore ad accesso casuale sulle query.
+     * @tparam OutputIt Tipo dell'iteratore ad accesso casuale sugli esiti.
+     * @param first Prima query.
+     * @param last Fine delle query.
+     * @param result Destinazione degli esiti, nello stesso ordine delle query.
+     * @throw std::runtime_error Se si verifica un errore durante la ricerca.
+     */
+    template<typename RandomIt, typename OutputIt>
+    void exists_batch(RandomIt first, RandomIt last, OutputIt result) const {
+        BINARYTREE_TRACE_SCOPE("exists_batch");
+        BINARYTREE_TRY {
+            exists_sorted(root, first, last, result);
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Conta gli elementi in intervalli adiacenti con una sola visita.
+     * 
+     * Con m confini b[0] < ... < b[m-1] gli intervalli sono m + 1: il primo
+     * contiene le chiavi minori di b[0], l'i-esimo quelle in [b[i-1], b[i]),
+     * l'ultimo quelle non minori di b[m-1]. Costo O(m log n) con le
+     * dimensioni dei sottoalberi, O(n) senza.
+     * 
+     * @param boundaries Confini ordinati secondo compare e distinti.
+     * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+     * @return std::vector<size_t> Conteggio per ciascuno degli m + 1 intervalli.
+     */
+    std::vector<size_t> histogram(const std::vector<T>& boundaries, unsigned threads = 1) const {
+        BINARYTREE_TRACE_SCOPE("histogram");
+        std::vector<size_t> counts(boundaries.size() + 1, 0);
+        unsigned spawn_depth = binarytree_detail::spawn_depth(threads);
+        histogram_subtree(root, boundaries.begin(), boundaries.end(), 0, counts.data(), counts.size(), spawn_depth);
+        return counts;
     }
 
     /**
@@ -275,19 +2825,109 @@ public:
      * @throw std::runtime_error Se si verifica un errore durante la ricerca.
      */
     BinaryTree subtree(const T& value) const {
-        BinaryTree sub_tree;
-        try {
-            Node* subtree_root = find_subtree(root, value);
-            if (subtree_root) {
-                copy_subtree(sub_tree.root, subtree_root);
-                sub_tree.node_count = sub_tree.count_nodes(sub_tree.root);
+        TreeResult<BinaryTree> sub_tree = try_subtree(value);
+        BINARYTREE_TRY {
+            return std::move(sub_tree.value());
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di subtree che riporta gli errori con un codice.
+     * 
+     * @param value Valore da cercare nel sottoalbero.
+     * @return TreeResult<BinaryTree> Sottoalbero (vuoto se il valore manca), oppure TreeError::out_of_memory.
+     */
+    TreeResult<BinaryTree> try_subtree(const T& value) const {
+        BINARYTREE_TRACE_SCOPE("subtree");
+        BINARYTREE_PROBE(subtree_entry, node_count);
+        binarytree_detail::probe_stats stats;
+        BinaryTree sub_tree(compare, equal);
+        offset_type offset;
+        Node* subtree_root = find_node(value, stats, &offset);
+        if (subtree_root) {
+            TreeError err = copy_tree(subtree_root, sub_tree.root);
+            if (err != TreeError::none) {
+                return err;
             }
-        } catch (std::exception& e) {
-            throw; // Rilancia l'eccezione
+            apply_offset(sub_tree.root, offset);
+            sub_tree.node_count = subtree_size(sub_tree.root);
+            sub_tree.pending_budget = pending_budget;
         }
+        sub_tree.enable_top_cache(top_cache_levels());
+        BINARYTREE_PROBE(subtree_return, stats.depth, stats.comparisons, sub_tree.node_count);
         return sub_tree;
     }
 
+    /**
+     * @brief Visita in ordine tutti gli elementi anticipando il caricamento dei nodi.
+     * 
+     * Usa una pila esplicita, così i nodi da visitare in seguito sono noti in
+     * anticipo. Con prefetch_distance > 0, ogni nodo messo sulla pila
+     * richiede in anticipo il figlio destro, che verrà visitato dopo tutto il
+     * sottoalbero sinistro; inoltre a ogni visita si richiedono i nipoti del
+     * prefetch_distance-esimo nodo in attesa sulla pila, così i cammini che
+     * verranno percorsi dopo sono già in cache quando servono.
+     * Con prefetch_distance == 0 non viene emesso alcun prefetch.
+     * 
+     * @tparam Function Tipo della funzione, invocata con const T&.
+     * @param f Funzione da applicare a ogni elemento.
+     * @param prefetch_distance Nodi in attesa di anticipo rispetto alla visita corrente.
+     */
+    template<typename Function>
+    void scan(Function f, size_t prefetch_distance = 4) const {
+        BINARYTREE_TRACE_SCOPE("scan");
+        auto visit = [&f](Node* node, const offset_type& offset) {
+            f(static_cast<const T&>(offset.key(node->data)));
+        };
+        scan_subtree(root, visit, prefetch_distance);
+    }
+
+    /**
+     * @brief Esporta i campi degli elementi in colonne contigue, in ordine.
+     * 
+     * Ogni estrattore è un functore che riceve const T& e restituisce un
+     * campo: i campi aritmetici finiscono in un std::vector (i bool in un
+     * std::vector<uint8_t>), quelli convertibili in std::string_view in una
+     * StringColumn. Tutte le colonne vengono riempite con una sola visita
+     * dell'albero.
+     * 
+     * @param extractors Estrattori dei campi.
+     * @return std::tuple Una colonna per estrattore, nello stesso ordine.
+     */
+    template<typename... Extractors>
+    std::tuple<binarytree_detail::column_t<T, Extractors>...> export_columns(Extractors... extractors) const {
+        return export_columns_parallel(1, extractors...);
+    }
+
+    /**
+     * @brief Esporta i campi degli elementi in colonne contigue usando più thread.
+     * 
+     * Come export_columns, ma i sottoalberi dei primi livelli vengono
+     * esportati in parallelo: le posizioni in ordine si ricavano dalle
+     * dimensioni dei sottoalberi, quindi ogni thread scrive direttamente la
+     * propria parte delle colonne aritmetiche e delle lunghezze delle
+     * stringhe; i caratteri vengono copiati nel buffer finale al termine.
+     * 
+     * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+     * @param extractors Estrattori dei campi.
+     * @return std::tuple Una colonna per estrattore, nello stesso ordine.
+     */
+    template<typename... Extractors>
+    std::tuple<binarytree_detail::column_t<T, Extractors>...> export_columns_parallel(unsigned threads, Extractors... extractors) const {
+        BINARYTREE_TRACE_SCOPE("export_columns");
+        typedef std::tuple<Extractors...> ExtractorTuple;
+        typedef std::tuple<typename binarytree_detail::column_traits<binarytree_detail::field_t<T, Extractors> >::chunk...> Chunks;
+        typedef std::make_index_sequence<sizeof...(Extractors)> indices;
+        std::tuple<binarytree_detail::column_t<T, Extractors>...> columns;
+        resize_columns<ExtractorTuple>(columns, node_count, indices());
+        unsigned spawn_depth = binarytree_detail::spawn_depth(threads);
+        ExtractorTuple all(extractors...);
+        std::vector<std::pair<size_t, Chunks> > segments;
+        export_subtree(root, 0, columns, segments, all, spawn_depth);
+        link_columns<ExtractorTuple>(columns, segments, indices());
+        return columns;
+    }
+
     /**
      * @brief Conta il numero di nodi in un sottoalbero a partire da un dato nodo.
      * 
@@ -303,93 +2943,171 @@ public:
 
 
     friend std::ostream& operator<<(std::ostream& os, const BinaryTree& tree) {
-        try {
+        BINARYTREE_TRY {
             tree.print_in_order(tree.root, os);
-        } catch (std::exception& e) {
-            throw; // Rilancia l'eccezione
-        }
+        } BINARYTREE_CATCH_RETHROW
         return os;
     }
     public:  
     /**
-     * @brief Iterator costante per attraversare l'albero in ordine.
+     * @brief Iterator costante bidirezionale per attraversare l'albero in ordine.
+     * 
+     * Gli spostamenti usano i puntatori al padre: ogni passo costa O(1)
+     * ammortizzato in entrambe le direzioni, senza ripartire dalla radice.
+     * Con lo spostamento pigro l'iteratore porta lo spostamento ereditato dal
+     * nodo corrente e la dereferenziazione restituisce una copia della chiave
+     * già spostata, senza scrivere nei nodi.
      */
-    class const_iterator
+    class const_iterator : private offset_type
     {
     public:
-        typedef std::forward_iterator_tag iterator_category; ///< Categoria dell'iteratore.
+        typedef std::bidirectional_iterator_tag iterator_category; ///< Categoria dell'iteratore.
         typedef std::ptrdiff_t difference_type; ///< Tipo per la differenza tra iteratori.
         typedef T value_type; ///< Tipo del valore puntato dall'iteratore.
         typedef const T* pointer; ///< Tipo del puntatore al valore.
-        typedef const T& reference; ///< Tipo del riferimento al valore.
+        typedef key_reference reference; ///< Tipo del riferimento al valore (una copia con lo spostamento pigro).
+
+    private:
+        Node *current; ///< Puntatore al nodo corrente dell'iteratore.
+        Node *root;    ///< Puntatore alla radice dell'albero, usato per decrementare end().
+
+        /**
+         * @brief Restituisce lo spostamento ereditato dal nodo corrente.
+         */
+        const offset_type &offset() const
+        {
+            return *this;
+        }
+
+        /**
+         * @brief Posiziona l'iteratore su un nodo.
+         * 
+         * @param node Nuovo nodo corrente.
+         * @param offset Spostamento ereditato dal nodo.
+         */
+        void move_to(Node *node, const offset_type &offset)
+        {
+            current = node;
+            static_cast<offset_type &>(*this) = offset;
+        }
 
-    private:
-        Node *current; ///< Puntatore al nodo corrente dell'iteratore.
-        Node *root;    ///< Puntatore alla radice dell'albero.
+        /**
+         * @brief Scende fino all'estremo di un sottoalbero.
+         * 
+         * @param node Radice del sottoalbero (non nullptr).
+         * @param offset Spostamento ereditato dalla radice.
+         * @param leftmost Se vero scende a sinistra, altrimenti a destra.
+         */
+        void descend(Node *node, offset_type offset, bool leftmost)
+        {
+            for (Node *child = leftmost ? node->left : node->right; child != nullptr;
+                 child = leftmost ? node->left : node->right)
+            {
+                offset = offset.below(node);
+                node = child;
+            }
+            move_to(node, offset);
+        }
 
         /**
-         * @brief Trova il nodo successivo nell'attraversamento in ordine.
+         * @brief Passa al nodo adiacente nell'attraversamento in ordine.
+         * 
+         * current diventa nullptr se non esiste.
          * 
-         * @param node Nodo corrente da cui trovare il successivo.
-         * @return Node* Nodo successivo nell'attraversamento.
+         * @param forward Se vero passa al successivo, altrimenti al precedente.
          */
-        Node *findNext(Node *node) const
+        void step(bool forward)
         {
-            if (node->right != nullptr)
+            Node *child = forward ? current->right : current->left;
+            if (child != nullptr)
             {
-                Node *next = node->right;
-                while (next->left != nullptr)
-                {
-                    next = next->left;
-                }
-                return next;
+                descend(child, offset().below(current), forward);
+                return;
             }
-            else
+            Node *node = current;
+            Node *parent = node->parent;
+            while (parent != nullptr && node == (forward ? parent->right : parent->left))
             {
-                Node *successor = nullptr;
-                Node *ancestor = root;
-                while (ancestor != node)
-                {
-                    if (node->data < ancestor->data)
-                    {
-                        successor = ancestor;
-                        ancestor = ancestor->left;
-                    }
-                    else
-                    {
-                        ancestor = ancestor->right;
-                    }
-                }
-                return successor;
+                node = parent;
+                parent = parent->parent;
+            }
+            if (parent == nullptr)
+            {
+                current = nullptr;
+                return;
             }
+            move_to(parent, ancestor_offset(current, offset(), parent));
+        }
+
+        friend class BinaryTree;
+
+        /**
+         * @brief Costruttore che posiziona l'iteratore esattamente su un nodo.
+         * 
+         * @param node Nodo su cui posizionare l'iteratore (nullptr per la fine).
+         * @param root Radice dell'albero.
+         * @param offset Spostamento ereditato dal nodo.
+         */
+        const_iterator(Node *node, Node *root, const offset_type &offset) : offset_type(offset), current(node), root(root)
+        {
         }
 
     public:
+        /**
+         * @brief Costruttore di default: iteratore singolare, uguale solo a se stesso.
+         */
+        const_iterator() : current(nullptr), root(nullptr)
+        {
+        }
+
         /**
          * @brief Costruttore dell'iteratore costante.
          * 
-         * @param node Nodo iniziale dell'iteratore.
+         * @param node Nodo iniziale dell'iteratore (la radice, o nullptr per la fine).
          * @param root Radice dell'albero.
          */
         const_iterator(Node *node, Node *root) : current(node), root(root)
         {
+            BINARYTREE_PROBE(iterator_entry, static_cast<int>(current != nullptr));
+            binarytree_detail::probe_stats stats;
             if (current != nullptr)
             {
+                stats.visit();
+                offset_type offset;
                 while (current->left != nullptr)
                 {
+                    offset = offset.below(current);
                     current = current->left;
+                    stats.visit();
                 }
+                move_to(current, offset);
             }
+            BINARYTREE_PROBE(iterator_return, stats.depth);
         }
 
         /**
          * @brief Operatore di dereferenziazione.
          * 
-         * @return const T& Valore riferenziato dall'iteratore.
+         * @return reference Valore riferenziato dall'iteratore.
          */
-        const T &operator*() const
+        reference operator*() const
         {
-            return current->data;
+            return offset().key(current->data);
+        }
+
+        /**
+         * @brief Operatore di accesso ai membri.
+         * 
+         * Non disponibile con lo spostamento pigro, che riguarda solo chiavi
+         * aritmetiche (senza membri).
+         * 
+         * @return const T* Puntatore al valore riferenziato dall'iteratore.
+         */
+        const T *operator->() const
+        {
+            static_assert(!binarytree_detail::has_lazy_shift<T>::value,
+                          "operator-> is not available on keys with lazy shifts; use operator*.");
+            return &current->data;
         }
 
         /**
@@ -401,11 +3119,55 @@ public:
         {
             if (current != nullptr)
             {
-                current = findNext(current);
+                step(true);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Operatore di post-incremento.
+         * 
+         * @return const_iterator Copia dell'iteratore prima dell'incremento.
+         */
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        /**
+         * @brief Operatore di pre-decremento.
+         * 
+         * Decrementare end() porta all'ultimo elemento in ordine.
+         * 
+         * @return const_iterator& Referenza a se stesso dopo il decremento.
+         */
+        const_iterator &operator--()
+        {
+            if (current != nullptr)
+            {
+                step(false);
+            }
+            else if (root != nullptr)
+            {
+                descend(root, offset_type(), false);
             }
             return *this;
         }
 
+        /**
+         * @brief Operatore di post-decremento.
+         * 
+         * @return const_iterator Copia dell'iteratore prima del decremento.
+         */
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
         /**
          * @brief Operatore di confronto per l'uguaglianza.
          * 
@@ -431,6 +3193,263 @@ public:
         }
     };
 
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator; ///< Iteratore in ordine decrescente.
+
+#ifndef BINARYTREE_NO_SUBTREE_SIZES
+    static const bool has_subtree_sizes = true; ///< I nodi memorizzano la dimensione del sottoalbero.
+#else
+    static const bool has_subtree_sizes = false; ///< I nodi non memorizzano la dimensione del sottoalbero.
+#endif
+
+    /**
+     * @brief Cursore in sola lettura per discese personalizzate nell'albero.
+     * 
+     * Espone la struttura dell'albero (figli e padre) senza copiarla, così si
+     * possono scrivere ricerche potate in O(profondità), ad esempio la discesa
+     * verso la chiave con punteggio migliore. Ogni spostamento è O(1).
+     * Il cursore resta valido finché l'albero non viene modificato. Come
+     * const_iterator, con lo spostamento pigro porta lo spostamento ereditato
+     * dal nodo corrente invece di applicarlo ai nodi.
+     */
+    class cursor : private offset_type
+    {
+    private:
+        Node *node; ///< Nodo corrente (nullptr per un cursore vuoto).
+        Node *root; ///< Radice dell'albero, per convertire il cursore in iteratore.
+
+        friend class BinaryTree;
+
+        /**
+         * @brief Restituisce lo spostamento ereditato dal nodo corrente.
+         */
+        const offset_type &offset() const
+        {
+            return *this;
+        }
+
+        /**
+         * @brief Posiziona il cursore su un nodo.
+         * 
+         * @param next Nuovo nodo corrente.
+         * @param offset Spostamento ereditato dal nodo.
+         */
+        void move_to(Node *next, const offset_type &offset)
+        {
+            node = next;
+            static_cast<offset_type &>(*this) = offset;
+        }
+
+        /**
+         * @brief Costruttore che posiziona il cursore su un nodo.
+         * 
+         * @param node Nodo iniziale.
+         * @param root Radice dell'albero.
+         */
+        cursor(Node *node, Node *root) : node(node), root(root)
+        {
+        }
+
+    public:
+        /**
+         * @brief Costruttore di default: cursore vuoto.
+         */
+        cursor() : node(nullptr), root(nullptr)
+        {
+        }
+
+        /**
+         * @brief Verifica se il cursore è posizionato su un nodo.
+         * 
+         * @return true Se il cursore punta a un nodo.
+         * @return false Se il cursore è vuoto (albero vuoto).
+         */
+        bool valid() const
+        {
+            return node != nullptr;
+        }
+
+        /**
+         * @brief Restituisce la chiave del nodo corrente.
+         * 
+         * @return key_reference Chiave del nodo (il cursore deve essere valido).
+         */
+        key_reference key() const
+        {
+            return offset().key(node->data);
+        }
+
+        /**
+         * @brief Verifica se il nodo corrente ha un figlio sinistro.
+         * 
+         * @return true Se esiste il figlio sinistro.
+         * @return false Altrimenti.
+         */
+        bool has_left() const
+        {
+            return node != nullptr && node->left != nullptr;
+        }
+
+        /**
+         * @brief Verifica se il nodo corrente ha un figlio destro.
+         * 
+         * @return true Se esiste il figlio destro.
+         * @return false Altrimenti.
+         */
+        bool has_right() const
+        {
+            return node != nullptr && node->right != nullptr;
+        }
+
+        /**
+         * @brief Verifica se il nodo corrente ha un padre.
+         * 
+         * @return true Se il nodo non è la radice.
+         * @return false Altrimenti.
+         */
+        bool has_parent() const
+        {
+            return node != nullptr && node->parent != nullptr;
+        }
+
+        /**
+         * @brief Scende nel figlio sinistro, se esiste.
+         * 
+         * @return true Se il cursore si è spostato.
+         * @return false Se il figlio non esiste (il cursore resta fermo).
+         */
+        bool go_left()
+        {
+            if (!has_left())
+            {
+                return false;
+            }
+            move_to(node->left, offset().below(node));
+            return true;
+        }
+
+        /**
+         * @brief Scende nel figlio destro, se esiste.
+         * 
+         * @return true Se il cursore si è spostato.
+         * @return false Se il figlio non esiste (il cursore resta fermo).
+         */
+        bool go_right()
+        {
+            if (!has_right())
+            {
+                return false;
+            }
+            move_to(node->right, offset().below(node));
+            return true;
+        }
+
+        /**
+         * @brief Risale al padre, se esiste.
+         * 
+         * @return true Se il cursore si è spostato.
+         * @return false Se il nodo è la radice (il cursore resta fermo).
+         */
+        bool go_parent()
+        {
+            if (!has_parent())
+            {
+                return false;
+            }
+            move_to(node->parent, ancestor_offset(node, offset(), node->parent));
+            return true;
+        }
+
+        /**
+         * @brief Restituisce il numero di nodi del sottoalbero corrente.
+         * 
+         * O(1) quando has_subtree_sizes è vero, altrimenti visita il sottoalbero.
+         * 
+         * @return size_t Numero di nodi (0 per un cursore vuoto).
+         */
+        size_t subtree_size() const
+        {
+            return BinaryTree::subtree_size(node);
+        }
+
+        /**
+         * @brief Restituisce un iteratore posizionato sul nodo corrente.
+         * 
+         * @return const_iterator Iteratore sul nodo (end() per un cursore vuoto).
+         */
+        const_iterator position() const
+        {
+            return const_iterator(node, root, offset());
+        }
+
+        /**
+         * @brief Operatore di confronto per l'uguaglianza.
+         * 
+         * @param other Altro cursore da confrontare.
+         * @return true Se i due cursori puntano allo stesso nodo.
+         * @return false Altrimenti.
+         */
+        bool operator==(const cursor &other) const
+        {
+            return node == other.node;
+        }
+
+        /**
+         * @brief Operatore di confronto per l'ineguaglianza.
+         * 
+         * @param other Altro cursore da confrontare.
+         * @return true Se i due cursori puntano a nodi diversi.
+         * @return false Altrimenti.
+         */
+        bool operator!=(const cursor &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * @brief Restituisce un cursore posizionato sulla radice.
+     * 
+     * @return cursor Cursore sulla radice (vuoto se l'albero è vuoto).
+     */
+    cursor root_cursor() const
+    {
+        return cursor(root, root);
+    }
+
+    /**
+     * @brief Stacca dall'albero il sottoalbero radicato in un valore.
+     * 
+     * I nodi non vengono copiati: il sottoalbero viene scollegato dal padre
+     * e passa all'albero restituito. Costo O(profondità) per la ricerca e
+     * per aggiornare le dimensioni degli antenati (più O(k) per contare i
+     * nodi senza le dimensioni dei sottoalberi).
+     * 
+     * @param value Valore della radice del sottoalbero da staccare.
+     * @return BinaryTree Albero che possiede il sottoalbero (vuoto se il valore non esiste).
+     */
+    BinaryTree detach_subtree(const T& value)
+    {
+        binarytree_detail::probe_stats stats;
+        offset_type offset;
+        Node* node = find_node(value, stats, &offset);
+        return detach(node, offset);
+    }
+
+    /**
+     * @brief Stacca dall'albero il sottoalbero radicato nel nodo di un cursore.
+     * 
+     * Evita la ricerca: resta solo l'aggiornamento delle dimensioni degli
+     * antenati. Cursori e iteratori sui nodi staccati passano all'albero
+     * restituito ma non sono più validi per la conversione in iteratore.
+     * 
+     * @param c Cursore valido di questo albero.
+     * @return BinaryTree Albero che possiede il sottoalbero (vuoto se il cursore è vuoto o di un altro albero).
+     */
+    BinaryTree detach_subtree(const cursor& c)
+    {
+        return detach(c.root == root ? c.node : nullptr, c.offset());
+    }
+
     /**
      * @brief Restituisce l'iteratore costante per il primo nodo in ordine (più piccolo).
      * 
@@ -450,6 +3469,111 @@ public:
         return const_iterator(nullptr, root);
     }
 
+    /**
+     * @brief Restituisce l'iteratore inverso per l'ultimo nodo in ordine (più grande).
+     * 
+     * @return const_reverse_iterator Iteratore inverso al primo elemento in ordine decrescente.
+     */
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    /**
+     * @brief Restituisce l'iteratore inverso di fine per l'attraversamento decrescente.
+     * 
+     * @return const_reverse_iterator Iteratore inverso di fine.
+     */
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+#ifdef BINARYTREE_HAS_RANGES
+    /**
+     * @brief Restituisce una vista pigra sugli elementi compresi in [lo, hi].
+     * 
+     * La vista contiene solo due iteratori: non alloca e non copia elementi,
+     * quindi può essere composta con gli adattatori di std::views, ad esempio
+     * tree.range(a, b) | std::views::filter(pred). Resta valida finché
+     * l'albero non viene modificato.
+     * 
+     * @param lo Estremo inferiore (incluso).
+     * @param hi Estremo superiore (incluso).
+     * @return std::ranges::subrange<const_iterator> Vista sugli elementi dell'intervallo.
+     */
+    std::ranges::subrange<const_iterator> range(const T& lo, const T& hi) const {
+        if (compare(hi, lo) && !equal(hi, lo)) {
+            return std::ranges::subrange<const_iterator>(end(), end());
+        }
+        return std::ranges::subrange<const_iterator>(lower_bound(lo), upper_bound(hi));
+    }
+#endif
+
+    /**
+     * @brief Restituisce l'iteratore al primo elemento non minore di un valore.
+     * 
+     * @param value Valore di riferimento.
+     * @return const_iterator Iteratore al primo elemento >= value, oppure end().
+     */
+    const_iterator lower_bound(const T& value) const
+    {
+        Node *candidate = nullptr;
+        offset_type candidate_offset;
+        Node *node = root;
+        offset_type offset;
+        while (node != nullptr)
+        {
+            key_reference key = offset.key(node->data);
+            if (equal(key, value))
+            {
+                return const_iterator(node, root, offset);
+            }
+            if (compare(value, key))
+            {
+                candidate = node;
+                candidate_offset = offset;
+                offset = offset.below(node);
+                node = node->left;
+            }
+            else
+            {
+                offset = offset.below(node);
+                node = node->right;
+            }
+        }
+        return const_iterator(candidate, root, candidate_offset);
+    }
+
+    /**
+     * @brief Restituisce l'iteratore al primo elemento maggiore di un valore.
+     * 
+     * @param value Valore di riferimento.
+     * @return const_iterator Iteratore al primo elemento > value, oppure end().
+     */
+    const_iterator upper_bound(const T& value) const
+    {
+        Node *candidate = nullptr;
+        offset_type candidate_offset;
+        Node *node = root;
+        offset_type offset;
+        while (node != nullptr)
+        {
+            key_reference key = offset.key(node->data);
+            if (!equal(key, value) && compare(value, key))
+            {
+                candidate = node;
+                candidate_offset = offset;
+                offset = offset.below(node);
+                node = node->left;
+            }
+            else
+            {
+                offset = offset.below(node);
+                node = node->right;
+            }
+        }
+        return const_iterator(candidate, root, candidate_offset);
+    }
+
 };
 
 /**
@@ -464,11 +3588,9 @@ public:
  */
 template <typename T, typename Compare, typename Equal>
 std::ostream& operator<<(std::ostream& os, const BinaryTree<T, Compare, Equal>& tree) {
-    try {
+    BINARYTREE_TRY {
         tree.print_in_order(tree.root, os);
-    } catch (std::exception& e) {
-        throw; // Rilancia l'eccezione
-    }
+    } BINARYTREE_CATCH_RETHROW
     return os;
 }
 
@@ -492,4 +3614,13 @@ void printIF(const BinaryTree<T, Compare, Equal>& tree, Predicate pred) {
     std::cout << std::endl;
 }
 
+#ifdef BINARYTREE_HAS_RANGES
+static_assert(std::bidirectional_iterator<BinaryTree<int>::const_iterator>,
+              "BinaryTree::const_iterator must model std::bidirectional_iterator.");
+static_assert(std::ranges::bidirectional_range<const BinaryTree<int> >,
+              "BinaryTree must model std::ranges::bidirectional_range.");
+static_assert(std::ranges::sized_range<const BinaryTree<int> >,
+              "BinaryTree must model std::ranges::sized_range.");
+#endif
+
 #endif // BINARYTREE_HPP
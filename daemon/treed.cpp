@@ -0,0 +1,438 @@
+/**
+ * @file treed.cpp
+ * @brief Demone che serve un BinaryTree su un socket Unix.
+ *
+ * Carica un'istantanea (vedi tree_snapshot.hpp) e risponde alle richieste del
+ * protocollo definito in treeproto.hpp. Le richieste di tutte le connessioni
+ * lette nello stesso giro del ciclo di poll vengono accodate; le sequenze
+ * consecutive di letture vengono raggruppate in lotti e le verifiche di
+ * esistenza di un lotto vengono ordinate e risolte con un'unica
+ * BinaryTree::exists_batch. Gli inserimenti fanno da barriera, così ogni
+ * connessione vede sempre l'effetto delle proprie scritture precedenti.
+ * Da ogni connessione si accodano solo le richieste le cui risposte, nel
+ * caso peggiore, stanno entro max_pending_output byte in uscita: una
+ * connessione che non legge le risposte smette così di essere letta.
+ *
+ * Uso: treed.exe <socket> <snapshot> [-b dimensione_lotto] [-s salvataggio_in_uscita]
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "binarytree.hpp"
+#include "tree_snapshot.hpp"
+#include "treeproto.hpp"
+
+typedef BinaryTree<treeproto::key_type> KeyTree;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int) {
+    stop_requested = 1;
+}
+
+/**
+ * @brief Stato di una connessione.
+ */
+struct Client {
+    int fd; ///< Descrittore del socket.
+    std::vector<unsigned char> in; ///< Byte ricevuti non ancora interpretati.
+    std::vector<unsigned char> out; ///< Byte da inviare.
+    size_t out_pos; ///< Byte di out già inviati.
+    bool closing; ///< La connessione va chiusa dopo aver servito in e svuotato out.
+};
+
+/**
+ * @brief Richiesta in attesa di esecuzione.
+ */
+struct Pending {
+    size_t client; ///< Indice della connessione.
+    treeproto::request req; ///< Richiesta decodificata.
+};
+
+/**
+ * @brief Contatori esposti all'uscita.
+ */
+struct Stats {
+    unsigned long long requests; ///< Richieste servite.
+    unsigned long long batches; ///< Lotti di letture eseguiti.
+    unsigned long long batched_lookups; ///< Verifiche di esistenza risolte in lotto.
+};
+
+static const uint32_t default_range_limit = 4096; ///< Chiavi massime in una risposta di OP_RANGE.
+static const size_t max_pending_input = 256 * 1024; ///< Byte ricevuti e non interpretati per connessione.
+static const size_t max_pending_output = 4 * 1024 * 1024; ///< Byte in uscita per connessione, risposte accodate comprese.
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Chiavi massime della risposta a un OP_RANGE (req.limit limitato a default_range_limit).
+ */
+static uint32_t range_limit(const treeproto::request& req) {
+    return req.limit ? std::min(req.limit, default_range_limit) : default_range_limit;
+}
+
+/**
+ * @brief Byte massimi della risposta a una richiesta.
+ */
+static size_t response_bound(const treeproto::request& req) {
+    return treeproto::response_size + (req.op == treeproto::OP_RANGE ? range_limit(req) * sizeof(treeproto::key_type) : 0);
+}
+
+/**
+ * @brief Vero se conviene leggere altre richieste dalla connessione.
+ *
+ * Falso se il buffer di ingresso è pieno o se quello di uscita ha raggiunto
+ * max_pending_output: il client deve prima leggere le risposte.
+ */
+static bool wants_input(const Client& client) {
+    return client.in.size() < max_pending_input && client.out.size() - client.out_pos < max_pending_output;
+}
+
+static void append_response(std::vector<unsigned char>& out, const treeproto::response& resp,
+                            const std::vector<treeproto::key_type>* keys) {
+    size_t pos = out.size();
+    out.resize(pos + treeproto::response_size + (keys ? keys->size() * sizeof(treeproto::key_type) : 0));
+    treeproto::encode(resp, &out[pos]);
+    if (keys && !keys->empty()) {
+        std::memcpy(&out[pos + treeproto::response_size], keys->data(), keys->size() * sizeof(treeproto::key_type));
+    }
+}
+
+/**
+ * @brief Esegue una richiesta che non sia una verifica di esistenza.
+ */
+static void execute_single(KeyTree& tree, const treeproto::request& req, std::vector<unsigned char>& out) {
+    treeproto::response resp = {req.id, treeproto::ST_OK, 0, 0};
+    switch (req.op) {
+    case treeproto::OP_LOWER_BOUND:
+    case treeproto::OP_UPPER_BOUND: {
+        KeyTree::const_iterator it = req.op == treeproto::OP_LOWER_BOUND ? tree.lower_bound(req.a) : tree.upper_bound(req.a);
+        if (it == tree.end()) {
+            resp.status = treeproto::ST_NOT_FOUND;
+        } else {
+            resp.value = *it;
+        }
+        append_response(out, resp, nullptr);
+        return;
+    }
+    case treeproto::OP_RANGE: {
+        uint32_t limit = range_limit(req);
+        std::vector<treeproto::key_type> keys;
+        for (KeyTree::const_iterator it = tree.lower_bound(req.a); it != tree.end() && *it <= req.b; ++it) {
+            if (keys.size() == limit) {
+                resp.status = treeproto::ST_TRUNCATED;
+                break;
+            }
+            keys.push_back(*it);
+        }
+        resp.count = static_cast<uint32_t>(keys.size());
+        append_response(out, resp, &keys);
+        return;
+    }
+    case treeproto::OP_INSERT: {
+        // I duplicati sono un esito normale del protocollo: niente eccezioni sul percorso caldo.
+        TreeError err = tree.try_insert(req.a);
+        if (err == TreeError::duplicate) {
+            resp.status = treeproto::ST_DUPLICATE;
+        } else if (err == TreeError::out_of_memory) {
+            resp.status = treeproto::ST_OUT_OF_MEMORY;
+        }
+        append_response(out, resp, nullptr);
+        return;
+    }
+    default:
+        resp.status = treeproto::ST_BAD_REQUEST;
+        append_response(out, resp, nullptr);
+        return;
+    }
+}
+
+/**
+ * @brief Esegue un lotto di letture consecutive [first, last) della coda.
+ *
+ * Le verifiche di esistenza vengono ordinate e risolte insieme; le risposte
+ * vengono poi accodate nell'ordine originale delle richieste.
+ */
+static void execute_read_batch(KeyTree& tree, std::vector<Client>& clients, const std::vector<Pending>& queue,
+                               size_t first, size_t last, Stats& stats) {
+    std::vector<std::pair<treeproto::key_type, size_t> > lookups;
+    for (size_t i = first; i < last; ++i) {
+        if (queue[i].req.op == treeproto::OP_EXISTS) {
+            lookups.push_back(std::make_pair(queue[i].req.a, i));
+        }
+    }
+    std::sort(lookups.begin(), lookups.end());
+    std::vector<treeproto::key_type> keys(lookups.size());
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        keys[i] = lookups[i].first;
+    }
+    std::vector<char> found(lookups.size());
+    tree.exists_batch(keys.begin(), keys.end(), found.begin());
+
+    std::vector<char> exists_result(last - first);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        exists_result[lookups[i].second - first] = found[i];
+    }
+    for (size_t i = first; i < last; ++i) {
+        const treeproto::request& req = queue[i].req;
+        std::vector<unsigned char>& out = clients[queue[i].client].out;
+        if (req.op == treeproto::OP_EXISTS) {
+            treeproto::response resp = {req.id, exists_result[i - first] ? treeproto::ST_OK : treeproto::ST_NOT_FOUND, 0, 0};
+            append_response(out, resp, nullptr);
+        } else {
+            execute_single(tree, req, out);
+        }
+    }
+    stats.batches++;
+    stats.batched_lookups += lookups.size();
+}
+
+/**
+ * @brief Esegue la coda rispettando le barriere degli inserimenti.
+ */
+static void execute_queue(KeyTree& tree, std::vector<Client>& clients, const std::vector<Pending>& queue,
+                          size_t max_batch, Stats& stats) {
+    size_t i = 0;
+    while (i < queue.size()) {
+        if (queue[i].req.op == treeproto::OP_INSERT) {
+            execute_single(tree, queue[i].req, clients[queue[i].client].out);
+            ++i;
+            continue;
+        }
+        size_t end = i;
+        while (end < queue.size() && end - i < max_batch && queue[end].req.op != treeproto::OP_INSERT) {
+            ++end;
+        }
+        execute_read_batch(tree, clients, queue, i, end, stats);
+        i = end;
+    }
+    stats.requests += queue.size();
+}
+
+/**
+ * @brief Legge ciò che è disponibile su una connessione, fino a max_pending_input byte.
+ *
+ * @return false Se la connessione è stata chiusa dal client o è in errore.
+ */
+static bool read_available(Client& client) {
+    unsigned char buf[65536];
+    while (client.in.size() < max_pending_input) {
+        ssize_t n = ::read(client.fd, buf, std::min(sizeof(buf), max_pending_input - client.in.size()));
+        if (n > 0) {
+            client.in.insert(client.in.end(), buf, buf + n);
+            continue;
+        }
+        if (n == 0) {
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true; // Il resto verrà letto ai giri successivi.
+}
+
+/**
+ * @brief Invia quanto possibile del buffer di uscita.
+ *
+ * @return false Se la connessione è in errore.
+ */
+static bool flush_output(Client& client) {
+    while (client.out_pos < client.out.size()) {
+        ssize_t n = ::send(client.fd, &client.out[client.out_pos], client.out.size() - client.out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            client.out_pos += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        return false;
+    }
+    client.out.clear();
+    client.out_pos = 0;
+    return true;
+}
+
+static int open_listener(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::perror("socket");
+        return -1;
+    }
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 128) < 0 || !set_nonblocking(fd)) {
+        std::perror("bind/listen");
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage() {
+    std::cerr << "Usage: treed.exe <socket> <snapshot> [-b batch_size] [-s save_on_exit]" << std::endl;
+}
+
+/**
+ * @brief Funzione principale del demone.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    std::string socket_path = argv[1];
+    std::string snapshot_path = argv[2];
+    std::string save_path;
+    size_t max_batch = 256;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-b" && i + 1 < argc) {
+            max_batch = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "-s" && i + 1 < argc) {
+            save_path = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    TreeResult<KeyTree> loaded = try_load_snapshot<treeproto::key_type>(snapshot_path);
+    if (!loaded) {
+        std::cerr << snapshot_path << ": " << tree_error_message(loaded.error()) << std::endl;
+        return 1;
+    }
+    KeyTree tree = std::move(loaded.value());
+    std::cerr << "Loaded " << tree.size() << " keys from " << snapshot_path << std::endl;
+
+    int listener = open_listener(socket_path);
+    if (listener < 0) {
+        return 1;
+    }
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+    std::vector<Pending> queue;
+    Stats stats = {0, 0, 0};
+
+    while (!stop_requested) {
+        fds.clear();
+        pollfd lp = {listener, POLLIN, 0};
+        fds.push_back(lp);
+        for (size_t i = 0; i < clients.size(); ++i) {
+            short events = static_cast<short>((wants_input(clients[i]) ? POLLIN : 0) | (clients[i].out.empty() ? 0 : POLLOUT));
+            pollfd cp = {clients[i].fd, events, 0};
+            fds.push_back(cp);
+        }
+        if (::poll(fds.data(), fds.size(), 500) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::perror("poll");
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            for (;;) {
+                int fd = ::accept(listener, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                set_nonblocking(fd);
+                Client c = {fd, std::vector<unsigned char>(), std::vector<unsigned char>(), 0, false};
+                clients.push_back(c);
+            }
+        }
+
+        queue.clear();
+        for (size_t i = 0; i + 1 < fds.size(); ++i) {
+            Client& client = clients[i];
+            if ((fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) && wants_input(client)) {
+                if (!read_available(client)) {
+                    client.closing = true;
+                }
+            }
+            // Le richieste le cui risposte non starebbero in uscita restano in client.in.
+            size_t reserved = client.out.size() - client.out_pos;
+            size_t complete = client.in.size() / treeproto::request_size;
+            size_t taken = 0;
+            for (; taken < complete; ++taken) {
+                Pending p = {i, treeproto::decode_request(&client.in[taken * treeproto::request_size])};
+                size_t bound = response_bound(p.req);
+                if (reserved + bound > max_pending_output) {
+                    break;
+                }
+                reserved += bound;
+                queue.push_back(p);
+            }
+            client.in.erase(client.in.begin(), client.in.begin() + taken * treeproto::request_size);
+        }
+
+        execute_queue(tree, clients, queue, max_batch, stats);
+
+        for (size_t i = 0; i < clients.size();) {
+            bool ok = flush_output(clients[i]);
+            if (!ok || (clients[i].closing && clients[i].out.empty() && clients[i].in.size() < treeproto::request_size)) {
+                ::close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        ::close(clients[i].fd);
+    }
+    ::close(listener);
+    ::unlink(socket_path.c_str());
+
+    std::cerr << "Served " << stats.requests << " requests, " << stats.batches << " read batches, "
+              << stats.batched_lookups << " batched lookups" << std::endl;
+    if (!save_path.empty()) {
+        TreeError err = try_save_snapshot(tree, save_path);
+        if (err != TreeError::none) {
+            std::cerr << save_path << ": " << tree_error_message(err) << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file treeload.cpp
+ * @brief Generatore di carico e di istantanee per il demone treed.
+ *
+ * Uso:
+ *   treeload.exe snapshot <file> <n>
+ *       Scrive un'istantanea con le chiavi pari 0, 2, ..., 2(n-1): le chiavi
+ *       dispari sono quindi sempre assenti e permettono di misurare i mancati.
+ *   treeload.exe bench <socket> <n> [-c connessioni] [-d profondità] [-r richieste] [-w %inserimenti] [-g %intervalli]
+ *       Apre @c connessioni socket, tiene @c profondità richieste in volo su
+ *       ciascuno e invia in totale @c richieste operazioni casuali su chiavi
+ *       in [0, 2n). Stampa throughput e percentili di latenza.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "binarytree.hpp"
+#include "tree_snapshot.hpp"
+#include "treeproto.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Stato di una connessione del generatore.
+ */
+struct Connection {
+    int fd; ///< Descrittore del socket.
+    size_t in_flight; ///< Richieste inviate senza risposta.
+    std::vector<unsigned char> in; ///< Byte ricevuti non ancora interpretati.
+};
+
+static int connect_to(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static int make_snapshot(const std::string& path, long n) {
+    std::vector<treeproto::key_type> keys(static_cast<size_t>(n));
+    for (long i = 0; i < n; ++i) {
+        keys[static_cast<size_t>(i)] = 2 * static_cast<treeproto::key_type>(i);
+    }
+    try {
+        BinaryTree<treeproto::key_type> tree = BinaryTree<treeproto::key_type>::bulk_build(keys.begin(), keys.end());
+        save_snapshot(tree, path);
+    } catch (std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << n << " keys to " << path << std::endl;
+    return 0;
+}
+
+static int run_bench(const std::string& socket_path, long n, int argc, char** argv) {
+    size_t connections = 4;
+    size_t depth = 32;
+    size_t total = 200000;
+    int insert_pct = 0;
+    int range_pct = 0;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        long value = std::atol(argv[++i]);
+        if (arg == "-c") {
+            connections = static_cast<size_t>(std::max(1L, value));
+        } else if (arg == "-d") {
+            depth = static_cast<size_t>(std::max(1L, value));
+        } else if (arg == "-r") {
+            total = static_cast<size_t>(std::max(1L, value));
+        } else if (arg == "-w") {
+            insert_pct = static_cast<int>(value);
+        } else if (arg == "-g") {
+            range_pct = static_cast<int>(value);
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Connection> conns(connections);
+    for (size_t i = 0; i < connections; ++i) {
+        conns[i].fd = connect_to(socket_path);
+        conns[i].in_flight = 0;
+        if (conns[i].fd < 0) {
+            std::cerr << "Unable to connect to " << socket_path << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<treeproto::key_type> key_dist(0, 2 * static_cast<treeproto::key_type>(n) - 1);
+    std::uniform_int_distribution<int> pct(0, 99);
+    std::vector<double> latencies;
+    latencies.reserve(total);
+    std::vector<Clock::time_point> sent(total); // Istante di invio, indicizzato per id.
+    size_t issued = 0;
+    size_t completed = 0;
+    size_t hits = 0;
+    uint32_t next_id = 0;
+
+    Clock::time_point start = Clock::now();
+    std::vector<pollfd> fds(connections);
+    while (completed < total) {
+        for (size_t c = 0; c < connections; ++c) {
+            std::vector<unsigned char> out;
+            while (conns[c].in_flight < depth && issued < total) {
+                treeproto::request req;
+                req.id = next_id++;
+                int roll = pct(rng);
+                req.op = roll < insert_pct ? treeproto::OP_INSERT
+                       : roll < insert_pct + range_pct ? treeproto::OP_RANGE
+                       : treeproto::OP_EXISTS;
+                req.a = key_dist(rng);
+                req.b = req.a + 32;
+                req.limit = 0;
+                size_t pos = out.size();
+                out.resize(pos + treeproto::request_size);
+                treeproto::encode(req, &out[pos]);
+                sent[req.id] = Clock::now();
+                conns[c].in_flight++;
+                issued++;
+            }
+            if (!out.empty() && !write_all(conns[c].fd, out.data(), out.size())) {
+                std::cerr << "Connection lost" << std::endl;
+                return 1;
+            }
+            fds[c].fd = conns[c].fd;
+            fds[c].events = POLLIN;
+            fds[c].revents = 0;
+        }
+        if (::poll(fds.data(), fds.size(), 1000) <= 0) {
+            continue;
+        }
+        for (size_t c = 0; c < connections; ++c) {
+            if (!(fds[c].revents & POLLIN)) {
+                continue;
+            }
+            unsigned char buf[65536];
+            ssize_t got = ::read(conns[c].fd, buf, sizeof(buf));
+            if (got <= 0) {
+                std::cerr << "Connection closed by server" << std::endl;
+                return 1;
+            }
+            Connection& conn = conns[c];
+            conn.in.insert(conn.in.end(), buf, buf + got);
+            size_t pos = 0;
+            Clock::time_point now = Clock::now();
+            while (conn.in.size() - pos >= treeproto::response_size) {
+                treeproto::response resp = treeproto::decode_response(&conn.in[pos]);
+                size_t len = treeproto::response_size + resp.count * sizeof(treeproto::key_type);
+                if (conn.in.size() - pos < len) {
+                    break;
+                }
+                pos += len;
+                latencies.push_back(std::chrono::duration<double, std::micro>(now - sent[resp.id]).count());
+                if (resp.status == treeproto::ST_OK) {
+                    hits++;
+                }
+                conn.in_flight--;
+                completed++;
+            }
+            conn.in.erase(conn.in.begin(), conn.in.begin() + pos);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (size_t i = 0; i < connections; ++i) {
+        ::close(conns[i].fd);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "Requests: " << completed << " in " << seconds << " s" << std::endl;
+    std::cout << "Throughput: " << static_cast<long>(completed / seconds) << " req/s" << std::endl;
+    std::cout << "Latency p50: " << latencies[latencies.size() / 2] << " us, p99: "
+              << latencies[latencies.size() * 99 / 100] << " us" << std::endl;
+    std::cout << "Successful replies: " << hits << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Funzione principale del generatore.
+ *
+ * @return int Esito dell'esecuzione (0 se successo, altri valori per errore).
+ */
+int main(int argc, char** argv) {
+    if (argc >= 4 && std::string(argv[1]) == "snapshot") {
+        return make_snapshot(argv[2], std::atol(argv[3]));
+    }
+    if (argc >= 4 && std::string(argv[1]) == "bench") {
+        return run_bench(argv[2], std::max(1L, std::atol(argv[3])), argc - 4, argv + 4);
+    }
+    std::cerr << "Usage: treeload.exe snapshot <file> <n>" << std::endl;
+    std::cerr << "       treeload.exe bench <socket> <n> [-c conns] [-d depth] [-r requests] [-w insert%] [-g range%]" << std::endl;
+    return 1;
+}
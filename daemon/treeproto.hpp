@@ -0,0 +1,134 @@
+#ifndef TREEPROTO_HPP
+#define TREEPROTO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+/**
+ * @file treeproto.hpp
+ * @brief Protocollo binario compatto tra il demone treed e i suoi client.
+ *
+ * Ogni richiesta è un record di dimensione fissa (32 byte). Ogni risposta è
+ * un'intestazione di dimensione fissa (24 byte) seguita, solo per le richieste
+ * di intervallo, da @c count chiavi a 64 bit. Tutti i campi usano l'ordine dei
+ * byte nativo: il socket Unix collega sempre processi sulla stessa macchina.
+ * I client possono inviare più richieste senza attendere le risposte
+ * (pipelining); le risposte di una connessione arrivano nello stesso ordine
+ * delle richieste.
+ */
+
+namespace treeproto {
+
+typedef int64_t key_type; ///< Tipo delle chiavi servite dal demone.
+
+/**
+ * @brief Operazioni supportate.
+ */
+enum opcode : uint8_t {
+    OP_EXISTS = 1,      ///< Verifica se @c a è presente.
+    OP_LOWER_BOUND = 2, ///< Prima chiave >= @c a.
+    OP_UPPER_BOUND = 3, ///< Prima chiave > @c a.
+    OP_RANGE = 4,       ///< Chiavi in [@c a, @c b], al più @c limit.
+    OP_INSERT = 5       ///< Inserisce @c a.
+};
+
+/**
+ * @brief Esiti delle richieste.
+ */
+enum status : uint8_t {
+    ST_OK = 0,          ///< Operazione riuscita (per OP_EXISTS: chiave presente).
+    ST_NOT_FOUND = 1,   ///< Chiave o limite non trovato.
+    ST_DUPLICATE = 2,   ///< Inserimento di una chiave già presente.
+    ST_BAD_REQUEST = 3, ///< Codice operativo sconosciuto.
+    ST_TRUNCATED = 4,   ///< Intervallo troncato a @c limit chiavi.
+    ST_OUT_OF_MEMORY = 5 ///< Memoria esaurita sul server: la richiesta non è stata eseguita.
+};
+
+/**
+ * @brief Richiesta inviata dal client.
+ */
+struct request {
+    uint32_t id;    ///< Identificatore scelto dal client e restituito nella risposta.
+    uint8_t op;     ///< Valore di opcode.
+    uint32_t limit; ///< Numero massimo di chiavi per OP_RANGE (0 = limite del server, che è anche il massimo).
+    key_type a;     ///< Primo operando.
+    key_type b;     ///< Secondo operando (estremo superiore per OP_RANGE).
+};
+
+/**
+ * @brief Intestazione della risposta inviata dal server.
+ */
+struct response {
+    uint32_t id;    ///< Identificatore della richiesta.
+    uint8_t status; ///< Valore di status.
+    uint32_t count; ///< Numero di chiavi che seguono l'intestazione.
+    key_type value; ///< Chiave trovata per OP_LOWER_BOUND e OP_UPPER_BOUND.
+};
+
+static const size_t request_size = 32;  ///< Dimensione di una richiesta sul filo.
+static const size_t response_size = 24; ///< Dimensione di un'intestazione di risposta sul filo.
+
+/**
+ * @brief Serializza una richiesta.
+ *
+ * @param req Richiesta da serializzare.
+ * @param buf Buffer di almeno request_size byte.
+ */
+inline void encode(const request& req, unsigned char* buf) {
+    std::memset(buf, 0, request_size);
+    std::memcpy(buf, &req.id, 4);
+    buf[4] = req.op;
+    std::memcpy(buf + 8, &req.limit, 4);
+    std::memcpy(buf + 16, &req.a, 8);
+    std::memcpy(buf + 24, &req.b, 8);
+}
+
+/**
+ * @brief Deserializza una richiesta.
+ *
+ * @param buf Buffer di almeno request_size byte.
+ * @return request Richiesta letta.
+ */
+inline request decode_request(const unsigned char* buf) {
+    request req;
+    std::memcpy(&req.id, buf, 4);
+    req.op = buf[4];
+    std::memcpy(&req.limit, buf + 8, 4);
+    std::memcpy(&req.a, buf + 16, 8);
+    std::memcpy(&req.b, buf + 24, 8);
+    return req;
+}
+
+/**
+ * @brief Serializza l'intestazione di una risposta.
+ *
+ * @param resp Risposta da serializzare.
+ * @param buf Buffer di almeno response_size byte.
+ */
+inline void encode(const response& resp, unsigned char* buf) {
+    std::memset(buf, 0, response_size);
+    std::memcpy(buf, &resp.id, 4);
+    buf[4] = resp.status;
+    std::memcpy(buf + 8, &resp.count, 4);
+    std::memcpy(buf + 16, &resp.value, 8);
+}
+
+/**
+ * @brief Deserializza l'intestazione di una risposta.
+ *
+ * @param buf Buffer di almeno response_size byte.
+ * @return response Intestazione letta.
+ */
+inline response decode_response(const unsigned char* buf) {
+    response resp;
+    std::memcpy(&resp.id, buf, 4);
+    resp.status = buf[4];
+    std::memcpy(&resp.count, buf + 8, 4);
+    std::memcpy(&resp.value, buf + 16, 8);
+    return resp;
+}
+
+} // namespace treeproto
+
+#endif // TREEPROTO_HPP
@@ -0,0 +1,370 @@
+#ifndef FRONTCODED_TREE_HPP
+#define FRONTCODED_TREE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "binarytree.hpp"
+
+/**
+ * @brief Istantanea immutabile e compressa di un albero di stringhe.
+ *
+ * Le chiavi ordinate sono divise in blocchi di block_size() chiavi e
+ * codificate con front coding: ogni chiave è memorizzata come lunghezza del
+ * prefisso in comune con la precedente e suffisso restante (lunghezze in
+ * varint), mentre la prima chiave di ogni blocco è completa. Tutti i
+ * blocchi stanno in un unico buffer di byte, più un offset per blocco.
+ *
+ * exists fa una ricerca binaria sulle chiavi iniziali dei blocchi e poi
+ * decodifica sequenzialmente un solo blocco; l'iterazione decodifica le
+ * chiavi in ordine riusando la stessa stringa. Con chiavi dai prefissi
+ * lunghi (URL, percorsi, identificatori gerarchici) la memoria scende di
+ * più volte rispetto a nodi o vettori di std::string.
+ *
+ * Il front coding conviene con un ordine lessicografico (std::less o
+ * functori equivalenti), che è anche il caso in cui le ricerche confrontano
+ * i byte senza copiarli; con altri ordini resta corretto ma comprime meno.
+ *
+ * @tparam Compare Functore per confrontare due std::string.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due std::string.
+ */
+template<typename Compare = std::less<std::string>, typename Equal = std::equal_to<std::string> >
+class FrontCodedStringTree {
+public:
+    static const size_t default_block_size = 32; ///< Chiavi per blocco predefinite.
+
+    /**
+     * @brief Iteratore in ordine che decodifica una chiave alla volta.
+     *
+     * Il riferimento restituito resta valido fino al successivo incremento.
+     */
+    class const_iterator {
+    private:
+        const char* pos; ///< Prossima chiave codificata.
+        size_t rank; ///< Posizione della chiave corrente.
+        size_t count; ///< Chiavi totali.
+        std::string current; ///< Chiave corrente decodificata.
+
+        friend class FrontCodedStringTree;
+
+        const_iterator(const char* first, size_t rank, size_t count) : pos(first), rank(rank), count(count) {
+            if (rank < count) {
+                pos = decode(pos, current);
+            }
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category; ///< Categoria dell'iteratore.
+        typedef std::string value_type; ///< Tipo degli elementi.
+        typedef std::ptrdiff_t difference_type; ///< Tipo delle distanze.
+        typedef const std::string* pointer; ///< Puntatore a un elemento.
+        typedef const std::string& reference; ///< Riferimento a un elemento.
+
+        const_iterator() : pos(nullptr), rank(0), count(0) {}
+
+        reference operator*() const {
+            return current;
+        }
+
+        pointer operator->() const {
+            return &current;
+        }
+
+        const_iterator& operator++() {
+            if (++rank < count) {
+                pos = decode(pos, current);
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return rank == other.rank;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return rank != other.rank;
+        }
+    };
+
+private:
+    std::vector<char> bytes; ///< Blocchi codificati, contigui.
+    std::vector<size_t> block_offsets; ///< Inizio di ogni blocco in bytes.
+    size_t count; ///< Numero di chiavi.
+    size_t keys_per_block; ///< Chiavi per blocco.
+    Compare compare; ///< Functore per confrontare i dati.
+    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
+
+    /**
+     * @brief Vero se Compare è l'ordine lessicografico dei byte di std::string.
+     */
+    static const bool lexicographic = std::is_same<Compare, std::less<std::string> >::value ||
+                                      std::is_same<Compare, std::less<> >::value;
+
+    /**
+     * @brief Accoda un intero senza segno in formato varint (7 bit per byte).
+     */
+    void put_varint(size_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    /**
+     * @brief Legge un intero in formato varint e avanza il puntatore.
+     */
+    static size_t get_varint(const char*& pos) {
+        size_t value = 0;
+        unsigned shift = 0;
+        unsigned char byte;
+        do {
+            byte = static_cast<unsigned char>(*pos++);
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    /**
+     * @brief Decodifica una chiave sostituendo il suffisso della precedente.
+     *
+     * @param pos Inizio della chiave codificata.
+     * @param key Chiave precedente, sostituita con quella decodificata.
+     * @return const char* Inizio della chiave successiva.
+     */
+    static const char* decode(const char* pos, std::string& key) {
+        size_t shared = get_varint(pos);
+        size_t suffix = get_varint(pos);
+        key.resize(shared);
+        key.append(pos, suffix);
+        return pos + suffix;
+    }
+
+    /**
+     * @brief Accoda una chiave codificata rispetto alla precedente.
+     *
+     * @param key Chiave da accodare.
+     * @param previous Chiave precedente nello stesso blocco (nullptr per la prima).
+     */
+    void append(const std::string& key, const std::string* previous) {
+        if (count % keys_per_block == 0) {
+            block_offsets.push_back(bytes.size());
+            previous = nullptr;
+        }
+        size_t shared = 0;
+        if (previous) {
+            size_t limit = std::min(key.size(), previous->size());
+            while (shared < limit && key[shared] == (*previous)[shared]) {
+                ++shared;
+            }
+        }
+        put_varint(shared);
+        put_varint(key.size() - shared);
+        bytes.insert(bytes.end(), key.begin() + shared, key.end());
+        count++;
+    }
+
+    /**
+     * @brief Confronta la chiave iniziale di un blocco con un valore.
+     *
+     * @param block Indice del blocco.
+     * @param value Valore di riferimento.
+     * @param scratch Stringa di appoggio per i functori generici.
+     * @return true Se value precede la chiave iniziale del blocco.
+     */
+    bool precedes_head(size_t block, const std::string& value, std::string& scratch) const {
+        const char* pos = bytes.data() + block_offsets[block];
+        get_varint(pos); // Prefisso in comune: sempre 0 per la prima chiave del blocco.
+        size_t length = get_varint(pos);
+        if constexpr (lexicographic) {
+            return std::string_view(value) < std::string_view(pos, length);
+        } else {
+            scratch.assign(pos, length);
+            return compare(value, scratch);
+        }
+    }
+
+public:
+    /**
+     * @brief Costruisce un'istantanea vuota.
+     *
+     * @param block_size Chiavi per blocco (almeno 1; valori tipici 16-64).
+     * @param comp Functore per confrontare due std::string.
+     * @param eq Functore per verificare l'uguaglianza tra due std::string.
+     */
+    explicit FrontCodedStringTree(size_t block_size = default_block_size, Compare comp = Compare(), Equal eq = Equal())
+        : count(0), keys_per_block(std::max<size_t>(block_size, 1)), compare(comp), equal(eq) {}
+
+    /**
+     * @brief Comprime le chiavi di un albero di stringhe.
+     *
+     * @param tree Albero da cui leggere le chiavi in ordine.
+     * @param block_size Chiavi per blocco (almeno 1; valori tipici 16-64).
+     * @param comp Functore per confrontare due std::string.
+     * @param eq Functore per verificare l'uguaglianza tra due std::string.
+     */
+    explicit FrontCodedStringTree(const BinaryTree<std::string, Compare, Equal>& tree, size_t block_size = default_block_size,
+                                  Compare comp = Compare(), Equal eq = Equal())
+        : FrontCodedStringTree(block_size, comp, eq) {
+        block_offsets.reserve((tree.size() + keys_per_block - 1) / keys_per_block);
+        const std::string* previous = nullptr;
+        for (typename BinaryTree<std::string, Compare, Equal>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            append(*it, previous);
+            previous = &*it;
+        }
+        bytes.shrink_to_fit();
+    }
+
+    /**
+     * @brief Comprime un vettore di chiavi già ordinate e distinte.
+     *
+     * @param sorted Chiavi ordinate secondo comp.
+     * @param block_size Chiavi per blocco (almeno 1; valori tipici 16-64).
+     * @param comp Functore per confrontare due std::string.
+     * @param eq Functore per verificare l'uguaglianza tra due std::string.
+     */
+    explicit FrontCodedStringTree(const std::vector<std::string>& sorted, size_t block_size = default_block_size,
+                                  Compare comp = Compare(), Equal eq = Equal())
+        : FrontCodedStringTree(block_size, comp, eq) {
+        block_offsets.reserve((sorted.size() + keys_per_block - 1) / keys_per_block);
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            append(sorted[i], i > 0 ? &sorted[i - 1] : nullptr);
+        }
+        bytes.shrink_to_fit();
+    }
+
+    /**
+     * @brief Verifica se una chiave esiste nell'istantanea.
+     *
+     * Ricerca binaria sulle chiavi iniziali dei blocchi, poi decodifica
+     * sequenziale del blocco trovato fino alla chiave o alla prima maggiore.
+     *
+     * @param value Chiave da cercare.
+     * @return true Se la chiave esiste.
+     * @return false Altrimenti.
+     */
+    bool exists(const std::string& value) const {
+        std::string scratch;
+        // Primo blocco con chiave iniziale maggiore di value: la chiave può stare solo nel precedente.
+        size_t lo = 0;
+        size_t hi = block_offsets.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (precedes_head(mid, value, scratch)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        if (lo == 0) {
+            return false;
+        }
+        size_t block = lo - 1;
+        size_t keys = std::min(keys_per_block, count - block * keys_per_block);
+        const char* pos = bytes.data() + block_offsets[block];
+        scratch.clear();
+        for (size_t i = 0; i < keys; ++i) {
+            pos = decode(pos, scratch);
+            if (equal(scratch, value)) {
+                return true;
+            }
+            if (compare(value, scratch)) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Restituisce la chiave in una posizione dell'ordine.
+     *
+     * Decodifica al più block_size() chiavi del blocco che la contiene.
+     *
+     * @param rank Posizione della chiave (minore di size()).
+     * @return std::string Chiave decodificata.
+     */
+    std::string at(size_t rank) const {
+        size_t block = rank / keys_per_block;
+        const char* pos = bytes.data() + block_offsets[block];
+        std::string key;
+        for (size_t i = block * keys_per_block; i <= rank; ++i) {
+            pos = decode(pos, key);
+        }
+        return key;
+    }
+
+    /**
+     * @brief Restituisce il numero di chiavi.
+     *
+     * @return size_t Numero di chiavi.
+     */
+    size_t size() const {
+        return count;
+    }
+
+    /**
+     * @brief Restituisce il numero di chiavi per blocco.
+     *
+     * @return size_t Chiavi per blocco.
+     */
+    size_t block_size() const {
+        return keys_per_block;
+    }
+
+    /**
+     * @brief Restituisce i byte occupati dalle chiavi compresse e dagli offset dei blocchi.
+     *
+     * @return size_t Byte allocati (capacità dei due vettori).
+     */
+    size_t memory_bytes() const {
+        return bytes.capacity() + block_offsets.capacity() * sizeof(size_t);
+    }
+
+    /**
+     * @brief Restituisce l'iteratore alla prima chiave in ordine.
+     *
+     * @return const_iterator Iteratore alla prima chiave.
+     */
+    const_iterator begin() const {
+        return const_iterator(bytes.data(), 0, count);
+    }
+
+    /**
+     * @brief Restituisce l'iteratore di fine.
+     *
+     * @return const_iterator Iteratore di fine.
+     */
+    const_iterator end() const {
+        return const_iterator(nullptr, count, count);
+    }
+
+    /**
+     * @brief Stampa le chiavi in ordine.
+     *
+     * @param os Stream di output su cui stampare.
+     * @param tree Istantanea da stampare.
+     * @return std::ostream& Stream di output aggiornato.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const FrontCodedStringTree& tree) {
+        for (const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            os << *it << " ";
+        }
+        return os;
+    }
+};
+
+#endif // FRONTCODED_TREE_HPP
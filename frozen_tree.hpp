@@ -0,0 +1,511 @@
+#ifndef FROZEN_TREE_HPP
+#define FROZEN_TREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include "binarytree.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FROZEN_TREE_AVX2 1 ///< Kernel AVX2 compilati (usati solo se la CPU li supporta).
+#endif
+
+/**
+ * @brief Predicato vettorizzabile sulle chiavi aritmetiche di un FrozenBinaryTree.
+ *
+ * Combina un intervallo numerico chiuso (estremi opzionali) e, per le chiavi
+ * intere, la parità. Si costruisce per composizione, per esempio
+ * KeyFilter<int>().even().at_least(2).at_most(8). È anche un normale
+ * functore, quindi può essere passato a printIF.
+ *
+ * @tparam T Tipo aritmetico delle chiavi.
+ */
+template<typename T>
+struct KeyFilter {
+    static_assert(std::is_arithmetic<T>::value, "KeyFilter requires an arithmetic key type.");
+
+    /**
+     * @brief Vincolo di parità.
+     */
+    enum parity_kind {
+        ANY,  ///< Nessun vincolo.
+        EVEN, ///< Solo chiavi pari.
+        ODD   ///< Solo chiavi dispari.
+    };
+
+    bool has_lo = false; ///< Vero se lo è attivo.
+    bool has_hi = false; ///< Vero se hi è attivo.
+    T lo = T(); ///< Estremo inferiore incluso.
+    T hi = T(); ///< Estremo superiore incluso.
+    parity_kind parity = ANY; ///< Vincolo di parità.
+
+    /**
+     * @brief Restituisce il filtro con l'estremo inferiore (incluso) impostato.
+     */
+    KeyFilter at_least(T value) const {
+        KeyFilter f = *this;
+        f.has_lo = true;
+        f.lo = value;
+        return f;
+    }
+
+    /**
+     * @brief Restituisce il filtro con l'estremo superiore (incluso) impostato.
+     */
+    KeyFilter at_most(T value) const {
+        KeyFilter f = *this;
+        f.has_hi = true;
+        f.hi = value;
+        return f;
+    }
+
+    /**
+     * @brief Restituisce il filtro limitato all'intervallo chiuso [low, high].
+     */
+    KeyFilter between(T low, T high) const {
+        return at_least(low).at_most(high);
+    }
+
+    /**
+     * @brief Restituisce il filtro limitato alle chiavi pari.
+     */
+    KeyFilter even() const {
+        static_assert(std::is_integral<T>::value, "Parity filters require an integral key type.");
+        KeyFilter f = *this;
+        f.parity = EVEN;
+        return f;
+    }
+
+    /**
+     * @brief Restituisce il filtro limitato alle chiavi dispari.
+     */
+    KeyFilter odd() const {
+        static_assert(std::is_integral<T>::value, "Parity filters require an integral key type.");
+        KeyFilter f = *this;
+        f.parity = ODD;
+        return f;
+    }
+
+    /**
+     * @brief Valuta il predicato su una chiave.
+     *
+     * @param value Chiave da valutare.
+     * @return true Se la chiave soddisfa tutti i vincoli.
+     * @return false Altrimenti.
+     */
+    bool operator()(const T& value) const {
+        if (has_lo && !(lo <= value)) {
+            return false;
+        }
+        if (has_hi && !(value <= hi)) {
+            return false;
+        }
+        if constexpr (std::is_integral<T>::value) {
+            if (parity != ANY && ((value & 1) == 0) != (parity == EVEN)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+namespace frozen_tree_detail {
+
+#ifdef FROZEN_TREE_AVX2
+
+/**
+ * @brief Tabelle di compressione: per ogni maschera, gli indici delle corsie
+ * selezionate portati in testa (corsie a 32 bit, double come coppie).
+ */
+struct compress_tables {
+    std::array<std::array<int32_t, 8>, 256> lanes32; ///< Per 8 corsie a 32 bit.
+    std::array<std::array<int32_t, 8>, 16> lanes64; ///< Per 4 corsie a 64 bit.
+    std::array<std::array<int32_t, 8>, 9> prefix; ///< prefix[k]: prime k corsie a 32 bit attive.
+
+    constexpr compress_tables() : lanes32(), lanes64(), prefix() {
+        for (int mask = 0; mask < 256; ++mask) {
+            int k = 0;
+            for (int lane = 0; lane < 8; ++lane) {
+                if (mask & (1 << lane)) {
+                    lanes32[mask][k++] = lane;
+                }
+            }
+        }
+        for (int mask = 0; mask < 16; ++mask) {
+            int k = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    lanes64[mask][k++] = 2 * lane;
+                    lanes64[mask][k++] = 2 * lane + 1;
+                }
+            }
+        }
+        for (int k = 0; k <= 8; ++k) {
+            for (int lane = 0; lane < k; ++lane) {
+                prefix[k][lane] = -1;
+            }
+        }
+    }
+};
+
+inline constexpr compress_tables tables;
+
+/**
+ * @brief Vero se la CPU supporta AVX2 (verificato una sola volta).
+ */
+inline bool cpu_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+/**
+ * @brief Filtra chiavi int32 con AVX2: 8 per iterazione, compressione con
+ * permutazione da tabella e scrittura con maschera del solo prefisso valido.
+ *
+ * @return size_t Numero di chiavi scritte in out.
+ */
+__attribute__((target("avx2")))
+inline size_t filter_avx2(const int32_t* in, size_t n, const KeyFilter<int32_t>& f, int32_t* out) {
+    const __m256i lo = _mm256_set1_epi32(f.lo);
+    const __m256i hi = _mm256_set1_epi32(f.hi);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i want = _mm256_set1_epi32(f.parity == KeyFilter<int32_t>::ODD ? 1 : 0);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i keep = _mm256_set1_epi32(-1);
+        if (f.has_lo) {
+            keep = _mm256_andnot_si256(_mm256_cmpgt_epi32(lo, v), keep);
+        }
+        if (f.has_hi) {
+            keep = _mm256_andnot_si256(_mm256_cmpgt_epi32(v, hi), keep);
+        }
+        if (f.parity != KeyFilter<int32_t>::ANY) {
+            keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(_mm256_and_si256(v, one), want));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(keep));
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tables.lanes32[mask].data()));
+        int k = __builtin_popcount(mask);
+        __m256i store = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tables.prefix[k].data()));
+        _mm256_maskstore_epi32(out + count, store, _mm256_permutevar8x32_epi32(v, perm));
+        count += k;
+    }
+    for (; i < n; ++i) {
+        out[count] = in[i];
+        count += f(in[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Filtra chiavi double con AVX2: 4 per iterazione (vedi la versione int32).
+ *
+ * @return size_t Numero di chiavi scritte in out.
+ */
+__attribute__((target("avx2")))
+inline size_t filter_avx2(const double* in, size_t n, const KeyFilter<double>& f, double* out) {
+    const __m256d lo = _mm256_set1_pd(f.lo);
+    const __m256d hi = _mm256_set1_pd(f.hi);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(in + i);
+        // I confronti ordinati scartano i NaN, come la valutazione scalare.
+        __m256d keep = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+        if (f.has_lo) {
+            keep = _mm256_and_pd(keep, _mm256_cmp_pd(v, lo, _CMP_GE_OQ));
+        }
+        if (f.has_hi) {
+            keep = _mm256_and_pd(keep, _mm256_cmp_pd(v, hi, _CMP_LE_OQ));
+        }
+        int mask = _mm256_movemask_pd(keep);
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tables.lanes64[mask].data()));
+        int k = __builtin_popcount(mask);
+        __m256i store = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tables.prefix[2 * k].data()));
+        __m256d packed = _mm256_castsi256_pd(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(v), perm));
+        _mm256_maskstore_pd(out + count, store, packed);
+        count += k;
+    }
+    for (; i < n; ++i) {
+        out[count] = in[i];
+        count += f(in[i]);
+    }
+    return count;
+}
+
+#endif // FROZEN_TREE_AVX2
+
+/**
+ * @brief Filtro scalare senza salti: scrive sempre e avanza solo sulle chiavi selezionate.
+ *
+ * @return size_t Numero di chiavi scritte in out.
+ */
+template<typename T>
+size_t filter_scalar(const T* in, size_t n, const KeyFilter<T>& f, T* out) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[count] = in[i];
+        count += f(in[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Sceglie il kernel migliore disponibile per T.
+ *
+ * @return size_t Numero di chiavi scritte in out.
+ */
+template<typename T>
+size_t filter(const T* in, size_t n, const KeyFilter<T>& f, T* out) {
+#ifdef FROZEN_TREE_AVX2
+    if constexpr (std::is_same<T, int32_t>::value || std::is_same<T, double>::value) {
+        if (cpu_has_avx2()) {
+            return filter_avx2(in, n, f, out);
+        }
+    }
+#endif
+    return filter_scalar(in, n, f, out);
+}
+
+} // namespace frozen_tree_detail
+
+/**
+ * @brief Istantanea immutabile di un BinaryTree in un array contiguo.
+ *
+ * Gli elementi sono memorizzati ordinati in un unico vettore, così scansioni e
+ * iterazioni sono sequenziali. Per le ricerche si usa un indice dei primi
+ * elementi di ogni blocco di @c block_size elementi, disposto in ordine di
+ * Eytzinger (layout in ampiezza di un albero completo): la discesa
+ * nell'indice accede a posizioni 1, 2-3, 4-7, ... che stanno nelle stesse
+ * linee di cache per i primi livelli, e la ricerca termina con una scansione
+ * di un solo blocco contiguo.
+ *
+ * @tparam T Tipo dei dati contenuti.
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ */
+template<typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
+class FrozenBinaryTree {
+public:
+    typedef typename std::vector<T>::const_iterator const_iterator; ///< Iteratore in ordine.
+
+    static const size_t block_size = 16; ///< Elementi per blocco indicizzato.
+
+private:
+    std::vector<T> values; ///< Elementi ordinati.
+    std::vector<T> index; ///< Primi elementi dei blocchi in ordine di Eytzinger (posizione 0 inutilizzata).
+    std::vector<size_t> index_block; ///< Blocco corrispondente a ogni posizione di index.
+    Compare compare; ///< Functore per confrontare i dati.
+    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
+
+    /**
+     * @brief Riempie ricorsivamente l'indice in ordine di Eytzinger.
+     *
+     * @param k Posizione corrente nell'indice (radice = 1).
+     * @param next Prossimo blocco da assegnare in ordine.
+     */
+    void build_index(size_t k, size_t& next) {
+        if (k >= index.size()) {
+            return;
+        }
+        build_index(2 * k, next);
+        index[k] = values[next * block_size];
+        index_block[k] = next;
+        next++;
+        build_index(2 * k + 1, next);
+    }
+
+    /**
+     * @brief Prepara l'indice dei blocchi dopo aver caricato values.
+     */
+    void build() {
+        size_t blocks = (values.size() + block_size - 1) / block_size;
+        index.assign(blocks + 1, T());
+        index_block.assign(blocks + 1, 0);
+        size_t next = 0;
+        build_index(1, next);
+    }
+
+public:
+    /**
+     * @brief Costruisce un'istantanea vuota.
+     */
+    FrozenBinaryTree(Compare comp = Compare(), Equal eq = Equal()) : compare(comp), equal(eq) {}
+
+    /**
+     * @brief Congela gli elementi di un albero.
+     *
+     * @param tree Albero da cui copiare gli elementi in ordine.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    explicit FrozenBinaryTree(const BinaryTree<T, Compare, Equal>& tree, Compare comp = Compare(), Equal eq = Equal())
+        : compare(comp), equal(eq) {
+        values.reserve(tree.size());
+        for (typename BinaryTree<T, Compare, Equal>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            values.push_back(*it);
+        }
+        build();
+    }
+
+    /**
+     * @brief Congela un vettore di elementi già ordinati e distinti.
+     *
+     * @param sorted Elementi ordinati secondo comp, acquisiti dall'istantanea.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    explicit FrozenBinaryTree(std::vector<T>&& sorted, Compare comp = Compare(), Equal eq = Equal())
+        : values(std::move(sorted)), compare(comp), equal(eq) {
+        build();
+    }
+
+    /**
+     * @brief Restituisce la posizione del primo elemento non minore di un valore.
+     *
+     * @param value Valore di riferimento.
+     * @return size_t Posizione nell'ordine (size() se tutti gli elementi sono minori).
+     */
+    size_t lower_bound_index(const T& value) const {
+        if (values.empty()) {
+            return 0;
+        }
+        // Primo blocco il cui elemento iniziale è >= value.
+        size_t k = 1;
+        while (k < index.size()) {
+            k = 2 * k + (compare(index[k], value) && !equal(index[k], value) ? 1 : 0);
+        }
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+        size_t block = k == 0 ? index.size() - 1 : index_block[k];
+        if (k != 0 && equal(index[k], value)) {
+            return block * block_size;
+        }
+        // value cade nel blocco precedente (o prima del primo elemento).
+        if (block == 0) {
+            return 0;
+        }
+        size_t pos = (block - 1) * block_size;
+        size_t end = std::min(values.size(), block * block_size);
+        while (pos < end && compare(values[pos], value) && !equal(values[pos], value)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    /**
+     * @brief Verifica se un valore esiste nell'istantanea.
+     *
+     * @param value Valore da cercare.
+     * @return true Se il valore esiste.
+     * @return false Altrimenti.
+     */
+    bool exists(const T& value) const {
+        size_t pos = lower_bound_index(value);
+        return pos < values.size() && equal(values[pos], value);
+    }
+
+    /**
+     * @brief Copia in out, in ordine, le chiavi che soddisfano un filtro vettorizzabile.
+     *
+     * Se l'ordine dell'istantanea è quello numerico (Compare = std::less)
+     * gli estremi del filtro riducono prima l'intervallo con due ricerche
+     * binarie; senza vincolo di parità il risultato è una copia contigua.
+     * Il resto dell'intervallo viene valutato con AVX2 (chiavi int e double,
+     * scelto a runtime se la CPU lo supporta) o con un ciclo scalare senza
+     * salti, e le chiavi selezionate vengono compattate in out.
+     *
+     * @param f Filtro da applicare.
+     * @param out Buffer di output con spazio per almeno size() elementi.
+     * @return size_t Numero di chiavi scritte in out.
+     */
+    size_t filter_simd(const KeyFilter<T>& f, T* out) const {
+        const T* first = values.data();
+        const T* last = values.data() + values.size();
+        KeyFilter<T> rest = f;
+        if constexpr (std::is_same<Compare, std::less<T> >::value || std::is_same<Compare, std::less<> >::value) {
+            if (f.has_lo) {
+                first = std::lower_bound(first, last, f.lo);
+                rest.has_lo = false;
+            }
+            if (f.has_hi) {
+                last = std::max(first, std::upper_bound(first, last, f.hi));
+                rest.has_hi = false;
+            }
+            if (rest.parity == KeyFilter<T>::ANY) {
+                return static_cast<size_t>(std::copy(first, last, out) - out);
+            }
+        }
+        return frozen_tree_detail::filter(first, static_cast<size_t>(last - first), rest, out);
+    }
+
+    /**
+     * @brief Restituisce, in ordine, le chiavi che soddisfano un filtro vettorizzabile.
+     *
+     * @param f Filtro da applicare.
+     * @return std::vector<T> Chiavi selezionate.
+     */
+    std::vector<T> filter_simd(const KeyFilter<T>& f) const {
+        std::vector<T> out(values.size());
+        out.resize(filter_simd(f, out.data()));
+        return out;
+    }
+
+    /**
+     * @brief Restituisce il numero di elementi.
+     *
+     * @return size_t Numero di elementi.
+     */
+    size_t size() const {
+        return values.size();
+    }
+
+    /**
+     * @brief Restituisce l'array contiguo degli elementi ordinati.
+     *
+     * @return const T* Puntatore al primo elemento.
+     */
+    const T* data() const {
+        return values.data();
+    }
+
+    /**
+     * @brief Restituisce l'iteratore al primo elemento in ordine.
+     *
+     * @return const_iterator Iteratore al primo elemento.
+     */
+    const_iterator begin() const {
+        return values.begin();
+    }
+
+    /**
+     * @brief Restituisce l'iteratore di fine.
+     *
+     * @return const_iterator Iteratore di fine.
+     */
+    const_iterator end() const {
+        return values.end();
+    }
+
+    /**
+     * @brief Stampa gli elementi in ordine.
+     *
+     * @param os Stream di output su cui stampare.
+     * @param tree Istantanea da stampare.
+     * @return std::ostream& Stream di output aggiornato.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const FrozenBinaryTree& tree) {
+        for (const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            os << *it << " ";
+        }
+        return os;
+    }
+};
+
+#endif // FROZEN_TREE_HPP
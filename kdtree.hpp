@@ -0,0 +1,485 @@
+#ifndef KDTREE_HPP
+#define KDTREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "binarytree.hpp"
+
+/**
+ * @brief Albero k-d per ricerche su più campi numerici dello stesso record.
+ *
+ * Ogni asse è un functore che estrae dal record una coordinata numerica; il
+ * nodo di profondità d separa i sottoalberi secondo l'asse d % k. I nodi
+ * hanno la stessa forma di quelli di BinaryTree (dato, figli e padre),
+ * vengono allocati senza eccezioni e gli errori seguono lo stesso schema a
+ * codici (try_*) o eccezioni. A differenza di BinaryTree sono ammessi record
+ * con coordinate uguali: sono record distinti con la stessa posizione.
+ *
+ * Distruzione, copia e costruzione bilanciata usano le stesse funzioni di
+ * BinaryTree (binarytree_detail::destroy_subtree, copy_subtree e
+ * build_subtree). Il tipo Node invece è proprio: BinaryTree::Node è privato e
+ * porta campi che solo l'ordinamento totale mantiene (dimensione del
+ * sottoalbero, spostamento in sospeso, stato dei checkpoint), che qui
+ * sarebbero memoria sprecata e invarianti senza significato.
+ *
+ * bulk_build costruisce un albero bilanciato scegliendo a ogni livello la
+ * mediana lungo l'asse corrente (std::nth_element), in O(n log n); insert
+ * scende lungo gli assi senza ribilanciare.
+ *
+ * @tparam T Tipo dei record.
+ * @tparam Axes Functori che estraggono le coordinate, uno per dimensione.
+ */
+template<typename T, typename... Axes>
+class KdTree {
+public:
+    static const size_t dimensions = sizeof...(Axes); ///< Numero di assi.
+
+    typedef std::array<double, sizeof...(Axes)> point; ///< Punto nello spazio delle coordinate.
+
+private:
+    static_assert(sizeof...(Axes) > 0, "KdTree requires at least one axis.");
+
+    /**
+     * @brief Struttura per rappresentare un nodo dell'albero.
+     */
+    struct Node {
+        T data; ///< Record contenuto nel nodo.
+        Node* left; ///< Sottoalbero con coordinata minore sull'asse del nodo.
+        Node* right; ///< Sottoalbero con coordinata maggiore o uguale sull'asse del nodo.
+        Node* parent; ///< Puntatore al nodo padre (nullptr per la radice).
+
+        /**
+         * @brief Costruttore di Node.
+         *
+         * @param value Record da assegnare al nodo.
+         * @param parent Nodo padre del nuovo nodo.
+         */
+        Node(const T& value, Node* parent = nullptr) : data(value), left(nullptr), right(nullptr), parent(parent) {}
+    };
+
+    Node* root; ///< Radice dell'albero.
+    std::tuple<Axes...> axes; ///< Functori di estrazione delle coordinate.
+    size_t node_count; ///< Numero di nodi nell'albero.
+
+    /**
+     * @brief Restituisce la coordinata di un record lungo un asse scelto a runtime.
+     */
+    template<size_t... I>
+    double coordinate(const T& value, size_t axis, std::index_sequence<I...>) const {
+        double result = 0;
+        ((axis == I ? (result = static_cast<double>(std::get<I>(axes)(value)), 0) : 0), ...);
+        return result;
+    }
+
+    double coordinate(const T& value, size_t axis) const {
+        return coordinate(value, axis, std::index_sequence_for<Axes...>());
+    }
+
+    /**
+     * @brief Restituisce tutte le coordinate di un record.
+     */
+    point coordinates(const T& value) const {
+        point p;
+        for (size_t axis = 0; axis < dimensions; ++axis) {
+            p[axis] = coordinate(value, axis);
+        }
+        return p;
+    }
+
+    /**
+     * @brief Copia l'albero sorgente in una nuova radice.
+     *
+     * @param src Radice da copiare.
+     * @param dest Radice della copia (nullptr in caso di errore).
+     * @return TreeError TreeError::none oppure out_of_memory.
+     */
+    static TreeError copy_tree(const Node* src, Node*& dest) {
+        dest = nullptr;
+        if (!src) {
+            return TreeError::none;
+        }
+        auto clone = [](const Node* from, Node* parent) { return new (std::nothrow) Node(from->data, parent); };
+        auto finish = [](Node*) {};
+        if (!binarytree_detail::copy_subtree(dest, src, static_cast<Node*>(nullptr), clone, finish)) {
+            binarytree_detail::destroy_subtree(dest);
+            dest = nullptr;
+            return TreeError::out_of_memory;
+        }
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Costruisce un sottoalbero bilanciato con split mediano.
+     *
+     * Come BinaryTree::build_balanced, ma la sequenza non è ordinata: a ogni
+     * livello std::nth_element porta in posizione centrale la mediana lungo
+     * l'asse corrente. Come radice si sceglie il primo record con la stessa
+     * coordinata della mediana, così la discesa per asse (minore a sinistra,
+     * maggiore o uguale a destra) resta valida anche con coordinate ripetute.
+     * Se un'allocazione fallisce il sottoalbero resta vuoto e node_count non
+     * raggiunge il numero di record.
+     *
+     * @param values Record da disporre (riordinati sul posto).
+     * @return Node* Radice dell'albero costruito.
+     */
+    Node* build_median(std::vector<T>& values) {
+        auto split = [this, &values](size_t lo, size_t hi, size_t depth) {
+            size_t axis = depth % dimensions;
+            typename std::vector<T>::iterator first = values.begin() + lo;
+            typename std::vector<T>::iterator last = values.begin() + hi;
+            typename std::vector<T>::iterator mid = first + (hi - lo) / 2;
+            std::nth_element(first, mid, last, [&](const T& a, const T& b) {
+                return coordinate(a, axis) < coordinate(b, axis);
+            });
+            double median = coordinate(*mid, axis);
+            // [first, mid) ha coordinate <= median: la radice diventa il primo record uguale a median.
+            mid = std::partition(first, mid, [&](const T& v) { return coordinate(v, axis) < median; });
+            return static_cast<size_t>(mid - values.begin());
+        };
+        auto make = [this, &values](size_t index, Node* parent) {
+            Node* node = new (std::nothrow) Node(values[index], parent);
+            if (node) {
+                node_count++;
+            }
+            return node;
+        };
+        auto finish = [](Node*) {};
+        return binarytree_detail::build_subtree(0, values.size(), 0, static_cast<Node*>(nullptr), split, make, finish);
+    }
+
+    /**
+     * @brief Sottoalbero in attesa sulla pila di range_subtree e nearest_subtree.
+     */
+    struct pending_subtree {
+        const Node* node; ///< Radice del sottoalbero.
+        size_t depth; ///< Profondità della radice.
+        double plane; ///< Distanza al quadrato dal piano di separazione del padre (solo nearest_subtree).
+    };
+
+    /**
+     * @brief Visita i record di un sottoalbero contenuti in un box.
+     *
+     * Usa una pila esplicita: un albero costruito con insert può degenerare
+     * in una catena lunga quanto il numero di record.
+     */
+    template<typename Function>
+    void range_subtree(const Node* node, size_t depth, const point& lo, const point& hi, Function& f) const {
+        std::vector<pending_subtree> stack;
+        for (;;) {
+            while (node) {
+                point p = coordinates(node->data);
+                bool inside = true;
+                for (size_t axis = 0; axis < dimensions && inside; ++axis) {
+                    inside = lo[axis] <= p[axis] && p[axis] <= hi[axis];
+                }
+                if (inside) {
+                    f(static_cast<const T&>(node->data));
+                }
+                size_t axis = depth % dimensions;
+                bool go_left = lo[axis] < p[axis];
+                bool go_right = p[axis] <= hi[axis];
+                depth++;
+                if (go_left && go_right) {
+                    if (node->right) {
+                        stack.push_back(pending_subtree{node->right, depth, 0});
+                    }
+                    node = node->left;
+                } else {
+                    node = go_left ? node->left : (go_right ? node->right : nullptr);
+                }
+            }
+            if (stack.empty()) {
+                return;
+            }
+            node = stack.back().node;
+            depth = stack.back().depth;
+            stack.pop_back();
+        }
+    }
+
+    /**
+     * @brief Candidato della ricerca dei vicini.
+     *
+     * A parità di distanza vince il nodo visitato prima, così il risultato
+     * dipende solo dalla forma dell'albero e non dagli indirizzi dei nodi.
+     */
+    struct candidate {
+        double distance; ///< Distanza al quadrato dalla query.
+        size_t order; ///< Posizione del nodo nell'ordine di visita.
+        const Node* node; ///< Nodo candidato.
+
+        bool operator<(const candidate& other) const {
+            return distance < other.distance || (distance == other.distance && order < other.order);
+        }
+    };
+
+    /**
+     * @brief Ricerca dei k vicini più prossimi con una pila esplicita.
+     *
+     * Visita prima il lato del piano di separazione che contiene la query e
+     * scarta l'altro quando il piano è più lontano del k-esimo candidato. Il
+     * lato lontano resta sulla pila finché il lato vicino non è esaurito,
+     * quindi l'ordine di visita è quello della discesa ricorsiva, ma la
+     * profondità della pila di chiamate non dipende dalla forma dell'albero.
+     *
+     * @param visited Nodi visitati finora, usato come ordine dei candidati.
+     * @param best Max-heap dei migliori candidati finora.
+     */
+    void nearest_subtree(const Node* node, size_t depth, const point& query, size_t k, size_t& visited,
+                         std::priority_queue<candidate>& best) const {
+        std::vector<pending_subtree> stack;
+        for (;;) {
+            while (node) {
+                point p = coordinates(node->data);
+                double dist = 0;
+                for (size_t axis = 0; axis < dimensions; ++axis) {
+                    dist += (p[axis] - query[axis]) * (p[axis] - query[axis]);
+                }
+                candidate current = {dist, visited++, node};
+                if (best.size() < k) {
+                    best.push(current);
+                } else if (current < best.top()) {
+                    best.pop();
+                    best.push(current);
+                }
+                size_t axis = depth % dimensions;
+                double diff = query[axis] - p[axis];
+                const Node* far = diff < 0 ? node->right : node->left;
+                depth++;
+                if (far) {
+                    stack.push_back(pending_subtree{far, depth, diff * diff});
+                }
+                node = diff < 0 ? node->left : node->right;
+            }
+            while (!node && !stack.empty()) {
+                pending_subtree next = stack.back();
+                stack.pop_back();
+                if (best.size() < k || next.plane < best.top().distance) {
+                    node = next.node;
+                    depth = next.depth;
+                }
+            }
+            if (!node) {
+                return;
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Costruisce un albero vuoto con functori costruiti di default.
+     */
+    KdTree() : root(nullptr), axes(), node_count(0) {}
+
+    /**
+     * @brief Costruisce un albero vuoto.
+     *
+     * @param axis_functors Functori di estrazione delle coordinate.
+     */
+    explicit KdTree(Axes... axis_functors) : root(nullptr), axes(axis_functors...), node_count(0) {}
+
+    /**
+     * @brief Costruisce un albero bilanciato con split mediano.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @return KdTree Albero bilanciato contenente i record.
+     * @throw std::bad_alloc Se un'allocazione fallisce.
+     */
+    template<typename InputIt>
+    static KdTree bulk_build(InputIt first, InputIt last) {
+        return bulk_build(first, last, Axes()...);
+    }
+
+    /**
+     * @brief Costruisce un albero bilanciato con split mediano e functori specifici.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param axis_functors Functori di estrazione delle coordinate.
+     * @return KdTree Albero bilanciato contenente i record.
+     * @throw std::bad_alloc Se un'allocazione fallisce.
+     */
+    template<typename InputIt>
+    static KdTree bulk_build(InputIt first, InputIt last, Axes... axis_functors) {
+        TreeResult<KdTree> tree = try_bulk_build(first, last, axis_functors...);
+        BINARYTREE_TRY {
+            return std::move(tree.value());
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Variante di bulk_build che riporta gli errori con un codice.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @param axis_functors Functori di estrazione delle coordinate.
+     * @return TreeResult<KdTree> Albero bilanciato, oppure TreeError::out_of_memory.
+     */
+    template<typename InputIt>
+    static TreeResult<KdTree> try_bulk_build(InputIt first, InputIt last, Axes... axis_functors) {
+        KdTree tree(axis_functors...);
+        std::vector<T> values(first, last);
+        tree.root = tree.build_median(values);
+        if (tree.node_count != values.size()) {
+            return TreeError::out_of_memory; // Il distruttore di tree libera la costruzione parziale.
+        }
+        return tree;
+    }
+
+    /**
+     * @brief Costruttore di copia.
+     *
+     * @param other Albero da copiare.
+     * @throw std::bad_alloc Se un'allocazione fallisce.
+     */
+    KdTree(const KdTree& other) : root(nullptr), axes(other.axes), node_count(0) {
+        TreeError err = copy_tree(other.root, root);
+        if (err != TreeError::none) {
+            binarytree_detail::raise(err);
+        }
+        node_count = other.node_count;
+    }
+
+    /**
+     * @brief Costruttore di spostamento.
+     *
+     * @param other Albero da cui acquisire i nodi (resta vuoto).
+     */
+    KdTree(KdTree&& other) noexcept : root(other.root), axes(std::move(other.axes)), node_count(other.node_count) {
+        other.root = nullptr;
+        other.node_count = 0;
+    }
+
+    KdTree& operator=(const KdTree& other) {
+        KdTree copy(other);
+        std::swap(root, copy.root);
+        std::swap(node_count, copy.node_count);
+        axes = other.axes;
+        return *this;
+    }
+
+    KdTree& operator=(KdTree&& other) noexcept {
+        std::swap(root, other.root);
+        std::swap(node_count, other.node_count);
+        axes = std::move(other.axes);
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore che libera tutti i nodi.
+     */
+    ~KdTree() {
+        binarytree_detail::destroy_subtree(root);
+    }
+
+    /**
+     * @brief Inserisce un record scendendo lungo gli assi (senza ribilanciare).
+     *
+     * @param value Record da inserire.
+     * @throw std::bad_alloc Se l'allocazione del nodo fallisce.
+     */
+    void insert(const T& value) {
+        BINARYTREE_TRY {
+            TreeError err = try_insert(value);
+            if (err != TreeError::none) {
+                binarytree_detail::raise(err);
+            }
+        } BINARYTREE_CATCH_RETHROW
+    }
+
+    /**
+     * @brief Inserisce un record riportando l'esito con un codice.
+     *
+     * @param value Record da inserire.
+     * @return TreeError TreeError::none oppure out_of_memory.
+     */
+    TreeError try_insert(const T& value) {
+        Node* parent = nullptr;
+        Node** link = &root;
+        size_t depth = 0;
+        while (*link) {
+            parent = *link;
+            size_t axis = depth % dimensions;
+            link = coordinate(value, axis) < coordinate(parent->data, axis) ? &parent->left : &parent->right;
+            depth++;
+        }
+        Node* node = new (std::nothrow) Node(value, parent);
+        if (!node) {
+            return TreeError::out_of_memory;
+        }
+        *link = node;
+        node_count++;
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Applica una funzione ai record contenuti in un box allineato agli assi.
+     *
+     * @tparam Function Tipo della funzione, invocata con const T&.
+     * @param lo Estremi inferiori del box (inclusi).
+     * @param hi Estremi superiori del box (inclusi).
+     * @param f Funzione da applicare a ogni record nel box.
+     */
+    template<typename Function>
+    void range_query(const point& lo, const point& hi, Function f) const {
+        range_subtree(root, 0, lo, hi, f);
+    }
+
+    /**
+     * @brief Restituisce i record contenuti in un box allineato agli assi.
+     *
+     * @param lo Estremi inferiori del box (inclusi).
+     * @param hi Estremi superiori del box (inclusi).
+     * @return std::vector<T> Record nel box, in ordine di visita.
+     */
+    std::vector<T> range(const point& lo, const point& hi) const {
+        std::vector<T> result;
+        range_query(lo, hi, [&result](const T& value) { result.push_back(value); });
+        return result;
+    }
+
+    /**
+     * @brief Restituisce i k record più vicini a un punto (distanza euclidea).
+     *
+     * @param query Punto di riferimento.
+     * @param k Numero di record richiesti.
+     * @return std::vector<T> Al più k record, dal più vicino al più lontano.
+     */
+    std::vector<T> nearest(const point& query, size_t k) const {
+        std::vector<T> result;
+        if (k == 0) {
+            return result;
+        }
+        std::priority_queue<candidate> best;
+        size_t visited = 0;
+        nearest_subtree(root, 0, query, k, visited, best);
+        result.reserve(best.size());
+        for (; !best.empty(); best.pop()) {
+            result.push_back(best.top().node->data);
+        }
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /**
+     * @brief Restituisce il numero di record.
+     *
+     * @return size_t Numero di record.
+     */
+    size_t size() const {
+        return node_count;
+    }
+};
+
+#endif // KDTREE_HPP
@@ -0,0 +1,316 @@
+#ifndef LEARNED_INDEX_HPP
+#define LEARNED_INDEX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "binarytree.hpp"
+
+/**
+ * @brief Indice appreso su un'istantanea congelata di chiavi numeriche.
+ *
+ * Le chiavi, in ordine crescente, vengono approssimate da una sequenza di
+ * segmenti lineari (stile PGM) che predicono la posizione di una chiave con
+ * errore massimo garantito @p Epsilon. I primi elementi dei segmenti vengono a
+ * loro volta indicizzati ricorsivamente con errore @p InnerEpsilon finché resta
+ * un solo segmento. Una ricerca scende quindi i livelli con una predizione e
+ * una ricerca binaria limitata a 2 * Epsilon + 1 posizioni per livello.
+ *
+ * L'indice è immutabile: va ricostruito se l'albero di origine cambia.
+ *
+ * @tparam K Tipo aritmetico delle chiavi.
+ * @tparam Epsilon Errore massimo di posizione sull'array delle chiavi.
+ * @tparam InnerEpsilon Errore massimo di posizione sui livelli interni.
+ */
+template<typename K, size_t Epsilon = 32, size_t InnerEpsilon = 4>
+class LearnedIndex {
+    static_assert(std::is_arithmetic<K>::value, "LearnedIndex requires an arithmetic key type.");
+
+private:
+    /**
+     * @brief Segmento lineare che copre le posizioni a partire da start.
+     */
+    struct Segment {
+        K first_key; ///< Prima chiave coperta dal segmento.
+        double slope; ///< Pendenza della retta posizione/chiave.
+        size_t start; ///< Posizione della prima chiave coperta.
+    };
+
+    std::vector<K> keys; ///< Chiavi ordinate.
+    std::vector<std::vector<Segment> > levels; ///< levels[0] indicizza keys, levels[i] indicizza levels[i-1].
+
+    /**
+     * @brief Costruisce i segmenti con l'algoritmo del cono che si restringe.
+     *
+     * Per ogni segmento mantiene l'intervallo di pendenze che rispettano
+     * l'errore su tutti i punti visti; quando diventa vuoto il segmento si chiude.
+     *
+     * @param xs Chiavi ordinate e distinte.
+     * @param eps Errore massimo ammesso.
+     * @return std::vector<Segment> Segmenti che coprono xs.
+     */
+    static std::vector<Segment> build_segments(const std::vector<K>& xs, size_t eps) {
+        std::vector<Segment> segments;
+        size_t i = 0;
+        while (i < xs.size()) {
+            size_t start = i;
+            double x0 = static_cast<double>(xs[start]);
+            double lo = 0.0;
+            double hi = 1e300;
+            for (++i; i < xs.size(); ++i) {
+                double dx = static_cast<double>(xs[i]) - x0;
+                double dy = static_cast<double>(i - start);
+                if (dx <= 0.0) {
+                    break; // Chiavi indistinguibili in doppia precisione: nuovo segmento.
+                }
+                double new_lo = std::max(lo, (dy - static_cast<double>(eps)) / dx);
+                double new_hi = std::min(hi, (dy + static_cast<double>(eps)) / dx);
+                if (new_lo > new_hi) {
+                    break;
+                }
+                lo = new_lo;
+                hi = new_hi;
+            }
+            Segment seg = {xs[start], hi >= 1e300 ? 0.0 : (lo + hi) / 2, start};
+            segments.push_back(seg);
+        }
+        return segments;
+    }
+
+    /**
+     * @brief Predice la posizione di una chiave all'interno di un segmento.
+     *
+     * @param seg Segmento da usare.
+     * @param key Chiave da cercare.
+     * @param end Posizione successiva all'ultima coperta dal segmento.
+     * @return size_t Posizione predetta, limitata a [seg.start, end).
+     */
+    static size_t predict(const Segment& seg, const K& key, size_t end) {
+        double offset = seg.slope * (static_cast<double>(key) - static_cast<double>(seg.first_key));
+        if (!(offset > 0.0)) {
+            return seg.start;
+        }
+        double pos = static_cast<double>(seg.start) + offset;
+        if (pos >= static_cast<double>(end - 1)) {
+            return end - 1;
+        }
+        return static_cast<size_t>(pos);
+    }
+
+    /**
+     * @brief Trova nel livello dato l'ultimo segmento con first_key <= key.
+     *
+     * @param level Livello in cui cercare.
+     * @param pos Posizione predetta dal livello superiore.
+     * @param eps Errore della predizione.
+     * @param key Chiave da cercare.
+     * @return size_t Indice del segmento.
+     */
+    static size_t find_segment(const std::vector<Segment>& level, size_t pos, size_t eps, const K& key) {
+        size_t lo = pos > eps + 1 ? pos - eps - 1 : 0;
+        size_t hi = std::min(level.size(), pos + eps + 2);
+        typename std::vector<Segment>::const_iterator it =
+            std::upper_bound(level.begin() + lo, level.begin() + hi, key,
+                             [](const K& k, const Segment& s) { return k < s.first_key; });
+        size_t idx = static_cast<size_t>(it - level.begin());
+        return idx == 0 ? 0 : idx - 1;
+    }
+
+    /**
+     * @brief Costruisce un indice vuoto, da riempire con build.
+     */
+    LearnedIndex() {}
+
+    /**
+     * @brief Costruisce i livelli a partire dalle chiavi già caricate.
+     *
+     * @return TreeError TreeError::none oppure out_of_order se le chiavi non sono strettamente crescenti.
+     */
+    TreeError build() {
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (!(keys[i - 1] < keys[i])) {
+                return TreeError::out_of_order;
+            }
+        }
+        levels.clear();
+        if (keys.empty()) {
+            return TreeError::none;
+        }
+        levels.push_back(build_segments(keys, Epsilon));
+        while (levels.back().size() > 1) {
+            std::vector<K> firsts(levels.back().size());
+            for (size_t i = 0; i < firsts.size(); ++i) {
+                firsts[i] = levels.back()[i].first_key;
+            }
+            levels.push_back(build_segments(firsts, InnerEpsilon));
+        }
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Copia le chiavi in ordine di un albero.
+     */
+    template<typename Compare, typename Equal>
+    void load(const BinaryTree<K, Compare, Equal>& tree) {
+        keys.reserve(tree.size());
+        for (typename BinaryTree<K, Compare, Equal>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+            keys.push_back(*it);
+        }
+    }
+
+    /**
+     * @brief Costruisce i livelli segnalando l'errore ai costruttori.
+     */
+    void build_or_raise() {
+        TreeError err = build();
+        if (err != TreeError::none) {
+            binarytree_detail::raise(err);
+        }
+    }
+
+public:
+    /**
+     * @brief Costruisce l'indice da una sequenza di chiavi crescenti e distinte.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @throw std::runtime_error Se le chiavi non sono strettamente crescenti.
+     */
+    template<typename InputIt>
+    LearnedIndex(InputIt first, InputIt last) : keys(first, last) {
+        build_or_raise();
+    }
+
+    /**
+     * @brief Costruisce l'indice dalle chiavi in ordine di un albero.
+     *
+     * @tparam Compare Functore di confronto dell'albero (deve ordinare in modo crescente).
+     * @tparam Equal Functore di uguaglianza dell'albero.
+     * @param tree Albero di origine.
+     * @throw std::runtime_error Se l'ordine dell'albero non è quello numerico crescente.
+     */
+    template<typename Compare, typename Equal>
+    explicit LearnedIndex(const BinaryTree<K, Compare, Equal>& tree) {
+        load(tree);
+        build_or_raise();
+    }
+
+    /**
+     * @brief Variante del costruttore da sequenza che riporta gli errori con un codice.
+     *
+     * @tparam InputIt Tipo dell'iteratore di input.
+     * @param first Iteratore all'inizio della sequenza.
+     * @param last Iteratore alla fine della sequenza.
+     * @return TreeResult<LearnedIndex> Indice, oppure TreeError::out_of_order se le chiavi non sono strettamente crescenti.
+     */
+    template<typename InputIt>
+    static TreeResult<LearnedIndex> try_build(InputIt first, InputIt last) {
+        LearnedIndex index;
+        index.keys.assign(first, last);
+        TreeError err = index.build();
+        if (err != TreeError::none) {
+            return err;
+        }
+        return index;
+    }
+
+    /**
+     * @brief Variante del costruttore da albero che riporta gli errori con un codice.
+     *
+     * @tparam Compare Functore di confronto dell'albero.
+     * @tparam Equal Functore di uguaglianza dell'albero.
+     * @param tree Albero di origine.
+     * @return TreeResult<LearnedIndex> Indice, oppure TreeError::out_of_order se l'ordine dell'albero non è quello numerico crescente.
+     */
+    template<typename Compare, typename Equal>
+    static TreeResult<LearnedIndex> try_build(const BinaryTree<K, Compare, Equal>& tree) {
+        LearnedIndex index;
+        index.load(tree);
+        TreeError err = index.build();
+        if (err != TreeError::none) {
+            return err;
+        }
+        return index;
+    }
+
+    /**
+     * @brief Restituisce la posizione della prima chiave non minore di key.
+     *
+     * @param key Chiave da cercare.
+     * @return size_t Rango di key tra le chiavi (size() se tutte sono minori).
+     */
+    size_t lower_bound(const K& key) const {
+        if (keys.empty()) {
+            return 0;
+        }
+        size_t seg = 0;
+        for (size_t l = levels.size() - 1; l > 0; --l) {
+            const std::vector<Segment>& upper = levels[l];
+            size_t end = seg + 1 < upper.size() ? upper[seg + 1].start : levels[l - 1].size();
+            seg = find_segment(levels[l - 1], predict(upper[seg], key, end), InnerEpsilon, key);
+        }
+        const std::vector<Segment>& bottom = levels[0];
+        size_t end = seg + 1 < bottom.size() ? bottom[seg + 1].start : keys.size();
+        size_t pos = predict(bottom[seg], key, end);
+        size_t lo = pos > Epsilon + 1 ? pos - Epsilon - 1 : 0;
+        size_t hi = std::min(keys.size(), pos + Epsilon + 2);
+        return static_cast<size_t>(std::lower_bound(keys.begin() + lo, keys.begin() + hi, key) - keys.begin());
+    }
+
+    /**
+     * @brief Verifica se una chiave è presente.
+     *
+     * @param key Chiave da cercare.
+     * @return true Se la chiave è presente.
+     * @return false Altrimenti.
+     */
+    bool contains(const K& key) const {
+        size_t pos = lower_bound(key);
+        return pos < keys.size() && keys[pos] == key;
+    }
+
+    /**
+     * @brief Restituisce la chiave in una data posizione dell'ordine.
+     *
+     * @param pos Posizione (minore di size()).
+     * @return const K& Chiave in quella posizione.
+     */
+    const K& operator[](size_t pos) const {
+        return keys[pos];
+    }
+
+    /**
+     * @brief Restituisce il numero di chiavi indicizzate.
+     *
+     * @return size_t Numero di chiavi.
+     */
+    size_t size() const {
+        return keys.size();
+    }
+
+    /**
+     * @brief Restituisce il numero di segmenti dell'ultimo livello.
+     *
+     * @return size_t Numero di segmenti sulle chiavi.
+     */
+    size_t segment_count() const {
+        return levels.empty() ? 0 : levels[0].size();
+    }
+
+    /**
+     * @brief Restituisce la memoria occupata da chiavi e segmenti, in byte.
+     *
+     * @return size_t Byte occupati.
+     */
+    size_t memory_usage() const {
+        size_t bytes = keys.capacity() * sizeof(K);
+        for (size_t l = 0; l < levels.size(); ++l) {
+            bytes += levels[l].capacity() * sizeof(Segment);
+        }
+        return bytes;
+    }
+};
+
+#endif // LEARNED_INDEX_HPP
@@ -3,184 +3,20 @@
  * @brief Test dell'albero binario utilizzando tipi di dati diversi.
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <random>
+#include <vector>
 #include "binarytree.hpp"
-
-// Tipo custom per test
-struct CustomType {
-    int id; ///< Identificatore univoco.
-    std::string name; ///< Nome associato all'identificatore.
-
-    /**
-     * @brief Operatore di confronto '<' per il tipo CustomType.
-     * 
-     * @param other Altro oggetto CustomType da confrontare.
-     * @return true Se l'oggetto corrente è minore di 'other'.
-     * @return false Altrimenti.
-     */
-    bool operator<(const CustomType& other) const {
-        return id < other.id;
-    }
-
-    /**
-     * @brief Operatore di confronto '==' per il tipo CustomType.
-     * 
-     * @param other Altro oggetto CustomType da confrontare.
-     * @return true Se l'oggetto corrente è uguale a 'other'.
-     * @return false Altrimenti.
-     */
-    bool operator==(const CustomType& other) const {
-        return id == other.id;
-    }
-
-    /**
-     * @brief Operatore di stream '<<' per il tipo CustomType.
-     * 
-     * @param os Stream di output su cui stampare.
-     * @param obj Oggetto CustomType da stampare.
-     * @return std::ostream& Stream di output aggiornato.
-     */
-    friend std::ostream& operator<<(std::ostream& os, const CustomType& obj) {
-        os << "{" << obj.id << ", " << obj.name << "}";
-        return os;
-    }
-};
-
-// Functor di comparazione per il tipo int
-struct IntCompare {
-    /**
-     * @brief Operatore di confronto per il tipo int.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è minore di rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const int& lhs, const int& rhs) const {
-        return lhs < rhs;
-    }
-};
-
-// Functor di uguaglianza per il tipo int
-struct IntEqual {
-    /**
-     * @brief Operatore di uguaglianza per il tipo int.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è uguale a rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const int& lhs, const int& rhs) const {
-        return lhs == rhs;
-    }
-};
-
-// Functor per verificare se un valore è pari
-template<typename T>
-struct IsEven {
-    /**
-     * @brief Operatore di verifica per valore pari.
-     * 
-     * @param value Valore da verificare.
-     * @return true Se il valore è pari.
-     * @return false Altrimenti.
-     */
-    bool operator()(const T& value) const {
-        return value % 2 == 0;
-    }
-};
-
-// Functor di comparazione per il tipo double
-struct DoubleCompare {
-    /**
-     * @brief Operatore di confronto per il tipo double.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è minore di rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const double& lhs, const double& rhs) const {
-        return lhs < rhs;
-    }
-};
-
-// Functor di uguaglianza per il tipo double
-struct DoubleEqual {
-    /**
-     * @brief Operatore di uguaglianza per il tipo double.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è uguale a rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const double& lhs, const double& rhs) const {
-        return lhs == rhs;
-    }
-};
-
-// Functor di comparazione per il tipo string
-struct StringCompare {
-    /**
-     * @brief Operatore di confronto per il tipo string.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è minore di rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const std::string& lhs, const std::string& rhs) const {
-        return lhs < rhs;
-    }
-};
-
-// Functor di uguaglianza per il tipo string
-struct StringEqual {
-    /**
-     * @brief Operatore di uguaglianza per il tipo string.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è uguale a rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const std::string& lhs, const std::string& rhs) const {
-        return lhs == rhs;
-    }
-};
-
-// Functor di comparazione per il tipo CustomType
-struct CustomTypeCompare {
-    /**
-     * @brief Operatore di confronto per il tipo CustomType.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è minore di rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const CustomType& lhs, const CustomType& rhs) const {
-        return lhs.id < rhs.id;
-    }
-};
-
-// Functor di uguaglianza per il tipo CustomType
-struct CustomTypeEqual {
-    /**
-     * @brief Operatore di uguaglianza per il tipo CustomType.
-     * 
-     * @param lhs Primo operando.
-     * @param rhs Secondo operando.
-     * @return true Se lhs è uguale a rhs.
-     * @return false Altrimenti.
-     */
-    bool operator()(const CustomType& lhs, const CustomType& rhs) const {
-        return lhs.id == rhs.id;
-    }
-};
+#include "adaptive_tree.hpp"
+#include "frontcoded_tree.hpp"
+#include "frozen_tree.hpp"
+#include "kdtree.hpp"
+#include "radix_sort.hpp"
+#include "replicated_tree.hpp"
+#include "test_types.hpp"
 
 /**
  * @brief Funzione di test per un albero binario di tipo int.
@@ -199,6 +35,11 @@ void test_int_tree() {
         std::cout << "Tree size: " << tree.size() << std::endl;
         std::cout << "Tree contains 3: " << (tree.exists(3) ? "Yes" : "No") << std::endl;
         std::cout << "Tree contains 7: " << (tree.exists(7) ? "Yes" : "No") << std::endl;
+        std::cout << "try_insert(3): " << tree_error_message(tree.try_insert(3)) << std::endl;
+
+        std::vector<int> batch = {7, 9, 4};
+        std::cout << "try_apply_batch({7, 9, 4}): " << tree_error_message(tree.try_apply_batch(batch.begin(), batch.end()))
+                  << " Tree unchanged: " << tree << std::endl;
 
         BinaryTree<int, IntCompare, IntEqual> subtree = tree.subtree(3);
         std::cout << "Subtree rooted at 3: " << subtree << std::endl;
@@ -210,6 +51,27 @@ void test_int_tree() {
         assignedTree = tree;
         std::cout << "Assigned Tree: " << assignedTree << std::endl;
 
+        BinaryTree<int, IntCompare, IntEqual> detached = assignedTree.detach_subtree(3);
+        std::cout << "Detached subtree at 3: " << detached << "(left: " << assignedTree << ")" << std::endl;
+
+        // Discesa potata con il cursore: chiave più vicina a 7.
+        BinaryTree<int, IntCompare, IntEqual>::cursor c = tree.root_cursor();
+        int closest = c.key();
+        while (c.valid()) {
+            if (std::abs(c.key() - 7) < std::abs(closest - 7)) {
+                closest = c.key();
+            }
+            if (!(c.key() < 7 ? c.go_right() : c.go_left())) {
+                break;
+            }
+        }
+        std::cout << "Closest key to 7 (cursor descent): " << closest << std::endl;
+
+        tree.enable_top_cache(2);
+        std::cout << "Tree contains 4 (top cache, " << tree.top_cache_levels() << " levels): "
+                  << (tree.exists(4) ? "Yes" : "No") << std::endl;
+        std::cout << "Nodes under the root (cursor aggregate): " << tree.root_cursor().subtree_size() << std::endl;
+
         BinaryTree<int, IntCompare, IntEqual> treeEven;
         treeEven.insert(4);
         treeEven.insert(2);
@@ -223,6 +85,40 @@ void test_int_tree() {
         std::cout << "Print only even int in the tree: ";
         printIF(treeEven, IsEven<int>());
 
+        BinaryTree<int, IntCompare, IntEqual> onlyEven = treeEven;
+        size_t removed = onlyEven.retain_if(IsEven<int>());
+        std::cout << "After retain_if(IsEven), " << removed << " removed: " << onlyEven << std::endl;
+
+        BinaryTree<int, IntCompare, IntEqual> copiedEven = treeEven.copy_if(IsEven<int>());
+        std::cout << "copy_if(IsEven), balanced copy: " << copiedEven << std::endl;
+
+        std::vector<int> sequence;
+        for (int i = 0; i < 1000; ++i) {
+            sequence.push_back(i);
+        }
+        BinaryTree<int, IntCompare, IntEqual> sequenceTree =
+            BinaryTree<int, IntCompare, IntEqual>::bulk_build(sequence.begin(), sequence.end());
+        std::vector<uint8_t> serialFlags = std::get<0>(sequenceTree.export_columns(IsEven<int>()));
+        std::vector<uint8_t> parallelFlags = std::get<0>(sequenceTree.export_columns_parallel(4, IsEven<int>()));
+        std::cout << "IsEven flags exported by 4 threads match the serial export: "
+                  << (parallelFlags == serialFlags ? "Yes" : "No") << std::endl;
+
+        FrozenBinaryTree<int, IntCompare, IntEqual> frozenEven(treeEven);
+        std::vector<int> evenInRange = frozenEven.filter_simd(KeyFilter<int>().even().between(2, 8));
+        std::cout << "Even int in [2, 8] (filter_simd): ";
+        for (size_t i = 0; i < evenInRange.size(); ++i) {
+            std::cout << evenInRange[i] << " ";
+        }
+        std::cout << std::endl;
+
+#ifdef BINARYTREE_HAS_RANGES
+        std::cout << "Even int in [2, 8] (lazy view): ";
+        for (int value : treeEven.range(2, 8) | std::views::filter(IsEven<int>())) {
+            std::cout << value << " ";
+        }
+        std::cout << std::endl;
+#endif
+
     } catch (std::exception& e) {
         std::cerr << "Exception caught: " << e.what() << std::endl;
     }
@@ -242,6 +138,12 @@ void test_double_tree() {
 
         std::cout << "Double Tree: " << tree << std::endl;
 
+        std::cout << "Double Tree (descending): ";
+        for (BinaryTree<double, DoubleCompare, DoubleEqual>::const_reverse_iterator it = tree.rbegin(); it != tree.rend(); ++it) {
+            std::cout << *it << " ";
+        }
+        std::cout << std::endl;
+
         std::cout << "Tree size: " << tree.size() << std::endl;
         std::cout << "Tree contains 3.3: " << (tree.exists(3.3) ? "Yes" : "No") << std::endl;
         std::cout << "Tree contains 7.7: " << (tree.exists(7.7) ? "Yes" : "No") << std::endl;
@@ -255,6 +157,74 @@ void test_double_tree() {
         BinaryTree<double, DoubleCompare, DoubleEqual> assignedTree;
         assignedTree = tree;
         std::cout << "Assigned Tree: " << assignedTree << std::endl;
+
+        std::vector<double> boundaries = {2.0, 5.0};
+        std::vector<size_t> buckets = tree.histogram(boundaries);
+        std::cout << "Histogram (<2, [2,5), >=5): " << buckets[0] << " " << buckets[1] << " " << buckets[2] << std::endl;
+
+        assignedTree.shift(4.0, 9.0, 0.5);
+        std::cout << "Keys in [4, 9] shifted by 0.5: " << assignedTree << std::endl;
+        assignedTree.shift(1.0, 2.0, 3.0); // 1.1 + 3 supererebbe 3.3: lancia.
+    } catch (std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Verifica bulk_build con l'ordinamento di default, che passa da radix_sort.
+ * 
+ * Le sequenze superano più volte la soglia per thread di radix_sort, così
+ * radix_sort(values, 4) percorre il ramo parallelo anche su macchine con un solo core.
+ */
+template<typename T>
+bool check_radix_bulk_build(std::vector<T> values) {
+    std::vector<T> expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<T> parallel = values;
+    radix_sort(parallel, 4);
+
+    BinaryTree<T> tree = BinaryTree<T>::bulk_build(values.begin(), values.end());
+    std::vector<T> inOrder(tree.begin(), tree.end());
+    return parallel == expected && inOrder == expected;
+}
+
+/**
+ * @brief Funzione di test di bulk_build su BinaryTree<int> e BinaryTree<double> con std::less.
+ */
+void test_radix_bulk_build() {
+    try {
+        const int n = 5 << 17;
+        std::mt19937 rng(42);
+
+        std::vector<int> ints;
+        for (int i = 0; i < n; ++i) {
+            ints.push_back((i - n / 2) * 3);
+        }
+        std::shuffle(ints.begin(), ints.end(), rng);
+        std::cout << n << " shuffled int, negatives included, sorted by radix_sort: "
+                  << (check_radix_bulk_build(ints) ? "Yes" : "No") << std::endl;
+
+        std::vector<double> doubles;
+        for (int i = 0; i < n; ++i) {
+            doubles.push_back((i - n / 2) * 0.37);
+        }
+        doubles.push_back(-1e300);
+        doubles.push_back(1e-300);
+        doubles.push_back(-1e-300);
+        std::shuffle(doubles.begin(), doubles.end(), rng);
+        std::cout << doubles.size() << " shuffled double, negatives included, sorted by radix_sort: "
+                  << (check_radix_bulk_build(doubles) ? "Yes" : "No") << std::endl;
+
+        // -0.0 e +0.0 sono equivalenti per std::less: radix_sort deve metterli vicini.
+        std::vector<double> zeros = {1.5, 0.0, -2.5, -0.0, 3.0};
+        TreeResult<BinaryTree<double> > withBothZeros = BinaryTree<double>::try_bulk_build(zeros.begin(), zeros.end());
+        std::cout << "bulk_build with -0.0 and +0.0 reports a duplicate: "
+                  << (withBothZeros.error() == TreeError::duplicate ? "Yes" : "No") << std::endl;
+
+        std::vector<double> negativeZero = {1.5, -0.0, -2.5, 3.0};
+        BinaryTree<double> signedZero = BinaryTree<double>::bulk_build(negativeZero.begin(), negativeZero.end());
+        std::cout << "bulk_build with -0.0 only: " << signedZero << std::endl;
     } catch (std::exception& e) {
         std::cerr << "Exception caught: " << e.what() << std::endl;
     }
@@ -278,6 +248,10 @@ void test_string_tree() {
         std::cout << "Tree contains 'apple': " << (tree.exists("apple") ? "Yes" : "No") << std::endl;
         std::cout << "Tree contains 'fig': " << (tree.exists("fig") ? "Yes" : "No") << std::endl;
 
+        FrontCodedStringTree<StringCompare, StringEqual> coded(tree, 2);
+        std::cout << "Front-coded (blocks of 2): " << coded << "- contains 'date': "
+                  << (coded.exists("date") ? "Yes" : "No") << ", " << coded.memory_bytes() << " bytes" << std::endl;
+
         BinaryTree<std::string, StringCompare, StringEqual> subtree = tree.subtree("apple");
         std::cout << "Subtree rooted at 'apple': " << subtree << std::endl;
 
@@ -327,6 +301,100 @@ void test_custom_tree() {
         BinaryTree<CustomType, CustomTypeCompare, CustomTypeEqual> assignedTree;
         assignedTree = tree;
         std::cout << "Assigned Tree: " << assignedTree << std::endl;
+
+        std::tuple<std::vector<int>, StringColumn> columns = tree.export_columns(CustomTypeId(), CustomTypeName());
+        const std::vector<int>& ids = std::get<0>(columns);
+        const StringColumn& names = std::get<1>(columns);
+        std::cout << "Columns (id: name): ";
+        for (size_t i = 0; i < ids.size(); ++i) {
+            std::cout << ids[i] << ": " << names[i] << " ";
+        }
+        std::cout << "(" << names.buffer.size() << " name bytes in one buffer)" << std::endl;
+    } catch (std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Funzione di test per l'albero adattivo con chiavi int.
+ */
+void test_adaptive_tree() {
+    try {
+        AdaptiveBinaryTree<int, IntCompare, IntEqual> tree;
+        for (int i = 0; i < 8; ++i) {
+            tree.insert(i * 3);
+        }
+        std::cout << "Adaptive Tree (inline): " << tree << std::endl;
+
+        for (int i = 8; i < 1000; ++i) {
+            tree.insert(i * 3);
+        }
+        std::cout << "Representation after build: "
+                  << (tree.current_representation() == tree.POINTER ? "pointer" : "other") << std::endl;
+
+        size_t found = 0;
+        for (int i = 0; i < 20000; ++i) {
+            found += tree.exists(i % 3000) ? 1 : 0;
+        }
+        std::cout << "Lookups found: " << found << std::endl;
+        std::cout << "Representation after reads: "
+                  << (tree.current_representation() == tree.FROZEN ? "frozen" : "other") << std::endl;
+        std::cout << "Tree size: " << tree.size() << std::endl;
+
+        // Oltre size()/16 inserimenti nel delta vengono fusi senza cambiare rappresentazione.
+        for (int i = 0; i < 70; ++i) {
+            tree.insert(i * 3 + 1);
+        }
+        std::cout << "Conversions: " << tree.conversion_count() << ", delta merges: " << tree.merge_count()
+                  << ", size: " << tree.size() << std::endl;
+    } catch (std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Funzione di test per l'albero con repliche di lettura.
+ */
+void test_replicated_tree() {
+    try {
+        ReplicatedBinaryTree<int> tree(2);
+        for (int i = 0; i < 10; ++i) {
+            tree.insert(i * 2);
+        }
+        std::shared_ptr<const ReplicatedBinaryTree<int>::Frozen> before = tree.snapshot();
+        tree.insert(7);
+        std::cout << "Replicas: " << tree.replica_count() << ", size: " << tree.size() << std::endl;
+        std::cout << "Contains 7: " << (tree.exists(7) ? "Yes" : "No")
+                  << ", snapshot taken before inserting 7 contains it: " << (before->exists(7) ? "Yes" : "No") << std::endl;
+    } catch (std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Funzione di test per l'albero k-d su record a due coordinate.
+ */
+void test_kdtree() {
+    try {
+        std::vector<Reading> readings = {
+            {1, 1.0, 1.0}, {2, 4.0, 2.0}, {3, 2.0, 5.0}, {4, 6.0, 6.0}, {5, 3.0, 3.0}, {6, 7.0, 1.0}
+        };
+        typedef KdTree<Reading, ReadingX, ReadingY> ReadingTree;
+        ReadingTree tree = ReadingTree::bulk_build(readings.begin(), readings.end());
+
+        std::cout << "Readings in [2, 5] x [1, 4]: ";
+        std::vector<Reading> inside = tree.range({2.0, 1.0}, {5.0, 4.0});
+        for (size_t i = 0; i < inside.size(); ++i) {
+            std::cout << inside[i] << " ";
+        }
+        std::cout << std::endl;
+
+        std::cout << "2 nearest readings to (3, 2): ";
+        std::vector<Reading> nearest = tree.nearest({3.0, 2.0}, 2);
+        for (size_t i = 0; i < nearest.size(); ++i) {
+            std::cout << nearest[i] << " ";
+        }
+        std::cout << std::endl;
     } catch (std::exception& e) {
         std::cerr << "Exception caught: " << e.what() << std::endl;
     }
@@ -346,6 +414,10 @@ int main() {
     test_double_tree();
     std::cout << std::endl;
 
+    std::cout << "Testing bulk_build with radix_sort on int and double:" << std::endl;
+    test_radix_bulk_build();
+    std::cout << std::endl;
+
     std::cout << "Testing BinaryTree with string type:" << std::endl;
     test_string_tree();
     std::cout << std::endl;
@@ -354,5 +426,23 @@ int main() {
     test_custom_tree();
     std::cout << std::endl;
 
+    std::cout << "Testing AdaptiveBinaryTree with int type:" << std::endl;
+    test_adaptive_tree();
+    std::cout << std::endl;
+
+    std::cout << "Testing ReplicatedBinaryTree with int type:" << std::endl;
+    test_replicated_tree();
+    std::cout << std::endl;
+
+    std::cout << "Testing KdTree with two-dimensional records:" << std::endl;
+    test_kdtree();
+    std::cout << std::endl;
+
+#ifdef BINARYTREE_TRACE
+    if (binarytree_trace::dump_file("main_trace.json")) {
+        std::cout << "Trace written to main_trace.json" << std::endl;
+    }
+#endif
+
     return 0;
 }
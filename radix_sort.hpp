@@ -0,0 +1,201 @@
+#ifndef RADIX_SORT_HPP
+#define RADIX_SORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file radix_sort.hpp
+ * @brief Ordinamento LSD radix per chiavi intere e in virgola mobile.
+ *
+ * Le chiavi vengono trasformate in interi senza segno il cui ordine coincide
+ * con quello di std::less (bit di segno invertito per gli interi con segno,
+ * trasformazione IEEE-754 per float e double), ordinate byte per byte e
+ * ritrasformate. Le passate in cui tutte le chiavi hanno lo stesso byte
+ * vengono saltate. Sopra una certa dimensione istogrammi e distribuzione
+ * vengono divisi tra più thread, mantenendo la stabilità.
+ */
+
+namespace radix_sort_detail {
+
+/**
+ * @brief Vero se T può essere ordinato con radix_sort.
+ */
+template<typename T>
+struct is_radix_key {
+    static const bool value = (std::is_integral<T>::value && !std::is_same<T, bool>::value && sizeof(T) <= 8)
+                           || std::is_same<T, float>::value || std::is_same<T, double>::value;
+};
+
+/**
+ * @brief Intero senza segno usato come chiave ordinabile per T.
+ */
+template<typename T>
+struct bits_of {
+    typedef typename std::conditional<(sizeof(T) <= 4), uint32_t, uint64_t>::type type;
+};
+
+/**
+ * @brief Trasforma un valore in un intero senza segno che ne preserva l'ordine.
+ */
+template<typename T>
+typename bits_of<T>::type to_ordered(T value) {
+    typedef typename bits_of<T>::type U;
+    if constexpr (std::is_floating_point<T>::value) {
+        typedef typename std::conditional<(sizeof(T) == 4), uint32_t, uint64_t>::type F;
+        F bits;
+        std::memcpy(&bits, &value, sizeof(T));
+        const F sign = F(1) << (sizeof(T) * 8 - 1);
+        return static_cast<U>((bits & sign) ? ~bits : (bits | sign));
+    } else if constexpr (std::is_signed<T>::value) {
+        typedef typename std::make_unsigned<T>::type S;
+        return static_cast<U>(static_cast<S>(value) ^ (S(1) << (sizeof(T) * 8 - 1)));
+    } else {
+        return static_cast<U>(value);
+    }
+}
+
+/**
+ * @brief Inverso di to_ordered.
+ */
+template<typename T>
+T from_ordered(typename bits_of<T>::type key) {
+    if constexpr (std::is_floating_point<T>::value) {
+        typedef typename std::conditional<(sizeof(T) == 4), uint32_t, uint64_t>::type F;
+        const F sign = F(1) << (sizeof(T) * 8 - 1);
+        F bits = static_cast<F>(key);
+        bits = (bits & sign) ? (bits & ~sign) : ~bits;
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    } else if constexpr (std::is_signed<T>::value) {
+        typedef typename std::make_unsigned<T>::type S;
+        return static_cast<T>(static_cast<S>(static_cast<S>(key) ^ (S(1) << (sizeof(T) * 8 - 1))));
+    } else {
+        return static_cast<T>(key);
+    }
+}
+
+static const size_t parallel_threshold = size_t(1) << 17; ///< Elementi minimi per thread.
+
+/**
+ * @brief Applica f(t, begin, end) a threads blocchi contigui di [0, n).
+ */
+template<typename F>
+void for_each_chunk(size_t n, unsigned threads, F f) {
+    if (threads <= 1) {
+        f(0u, size_t(0), n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.push_back(std::thread(f, t, n * t / threads, n * (t + 1) / threads));
+    }
+    f(0u, size_t(0), n / threads);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+}
+
+} // namespace radix_sort_detail
+
+/**
+ * @brief Ordina in modo crescente (secondo std::less) un vettore di chiavi aritmetiche.
+ *
+ * @tparam T Tipo delle chiavi (intero fino a 64 bit, float o double).
+ * @param values Valori da ordinare.
+ * @param threads Numero massimo di thread (0 = std::thread::hardware_concurrency()).
+ */
+template<typename T>
+void radix_sort(std::vector<T>& values, unsigned threads = 0) {
+    static_assert(radix_sort_detail::is_radix_key<T>::value, "radix_sort requires an integral or floating-point key.");
+    typedef typename radix_sort_detail::bits_of<T>::type U;
+    const size_t n = values.size();
+    if (n < 2) {
+        return;
+    }
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    size_t max_threads = n / radix_sort_detail::parallel_threshold;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    std::vector<U> keys(n);
+    std::vector<U> buffer(n);
+    radix_sort_detail::for_each_chunk(n, threads, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            keys[i] = radix_sort_detail::to_ordered<T>(values[i]);
+        }
+    });
+
+    std::vector<size_t> counts(static_cast<size_t>(threads) * 256);
+    for (unsigned pass = 0; pass < sizeof(T); ++pass) {
+        const unsigned shift = pass * 8;
+        std::fill(counts.begin(), counts.end(), 0);
+        radix_sort_detail::for_each_chunk(n, threads, [&](unsigned t, size_t begin, size_t end) {
+            size_t* local = &counts[static_cast<size_t>(t) * 256];
+            for (size_t i = begin; i < end; ++i) {
+                local[(keys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        // Se un solo byte raccoglie tutte le chiavi la passata non cambierebbe l'ordine.
+        bool trivial = false;
+        for (size_t d = 0; d < 256 && !trivial; ++d) {
+            size_t total = 0;
+            for (unsigned t = 0; t < threads; ++t) {
+                total += counts[static_cast<size_t>(t) * 256 + d];
+            }
+            trivial = total == n;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        // Posizione iniziale di ogni (byte, thread): prima per byte, poi per thread, per la stabilità.
+        size_t offset = 0;
+        for (size_t d = 0; d < 256; ++d) {
+            for (unsigned t = 0; t < threads; ++t) {
+                size_t c = counts[static_cast<size_t>(t) * 256 + d];
+                counts[static_cast<size_t>(t) * 256 + d] = offset;
+                offset += c;
+            }
+        }
+        radix_sort_detail::for_each_chunk(n, threads, [&](unsigned t, size_t begin, size_t end) {
+            size_t* local = &counts[static_cast<size_t>(t) * 256];
+            for (size_t i = begin; i < end; ++i) {
+                buffer[local[(keys[i] >> shift) & 0xFF]++] = keys[i];
+            }
+        });
+        keys.swap(buffer);
+    }
+
+    radix_sort_detail::for_each_chunk(n, threads, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            values[i] = radix_sort_detail::from_ordered<T>(keys[i]);
+        }
+    });
+}
+
+/**
+ * @brief Vero se un ordinamento con Compare equivale a radix_sort sulle chiavi T.
+ *
+ * Vale per chiavi aritmetiche con l'ordinamento di default (std::less).
+ */
+template<typename T, typename Compare>
+struct uses_radix_sort {
+    static const bool value = radix_sort_detail::is_radix_key<T>::value
+                           && (std::is_same<Compare, std::less<T> >::value || std::is_same<Compare, std::less<> >::value);
+};
+
+#endif // RADIX_SORT_HPP
@@ -0,0 +1,407 @@
+#ifndef REPLICATED_TREE_HPP
+#define REPLICATED_TREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "binarytree.hpp"
+#include "frozen_tree.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * @file replicated_tree.hpp
+ * @brief Albero con repliche di sola lettura per gruppo di core.
+ */
+
+/**
+ * @brief Insieme ordinato con una replica compatta per ogni gruppo di core.
+ *
+ * Le scritture vanno in un BinaryTree principale protetto da un mutex e
+ * vengono accodate a un log. Ogni gruppo di cores_per_replica core legge da
+ * una propria replica: un FrozenBinaryTree (array contiguo, nessun nodo
+ * condiviso fra i gruppi) più un piccolo delta ordinato. Una replica applica
+ * il log solo alla prima lettura successiva a una scrittura, dal thread che
+ * legge, e fonde il delta nell'array quando supera una frazione della sua
+ * dimensione; così anche la memoria di una replica viene toccata per prima
+ * dai core del suo gruppo.
+ *
+ * Lo stato di ogni replica è un'istantanea immutabile pubblicata con un
+ * puntatore atomico, in stile RCU: un lettore incrementa il contatore di
+ * lettori attivi della replica (condiviso quindi solo dai core del gruppo),
+ * legge il puntatore e usa lo stato senza lock; chi aggiorna pubblica un nuovo
+ * stato e libera il precedente solo dopo che i lettori che potevano vederlo
+ * sono usciti. Ogni lettura vede tutte le scritture completate prima del suo
+ * inizio.
+ *
+ * Il log conserva al più log_limit() elementi oltre quelli già applicati da
+ * tutte le repliche: una replica rimasta inattiva più a lungo non lo trattiene,
+ * ma alla lettura successiva viene ricostruita copiando l'albero principale.
+ *
+ * @tparam T Tipo dei dati contenuti.
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ */
+template<typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
+class ReplicatedBinaryTree {
+public:
+    typedef FrozenBinaryTree<T, Compare, Equal> Frozen; ///< Rappresentazione di una replica.
+
+    static const unsigned default_cores_per_replica = 4; ///< Core che condividono una replica.
+    static const size_t delta_divisor = 16; ///< Il delta viene fuso oltre size()/delta_divisor elementi.
+
+private:
+    typedef BinaryTree<T, Compare, Equal> Tree;
+
+    /**
+     * @brief Stato immutabile di una replica.
+     */
+    struct state {
+        std::shared_ptr<const Frozen> base; ///< Elementi fusi.
+        std::vector<T> delta; ///< Elementi applicati dal log e non ancora fusi, ordinati.
+        uint64_t seq; ///< Posizione del log fino a cui lo stato è aggiornato.
+    };
+
+    /**
+     * @brief Replica di un gruppo di core, su una propria linea di cache.
+     */
+    struct alignas(64) replica {
+        std::atomic<const state*> current; ///< Stato pubblicato (nullptr finché nessuno legge).
+        std::atomic<unsigned> epoch; ///< Il bit basso sceglie il contatore dei nuovi lettori.
+        std::atomic<size_t> readers[2]; ///< Lettori attivi per ciascuna parità di epoch.
+        std::atomic<uint64_t> applied; ///< Copia di current->seq per la potatura del log.
+        std::mutex update; ///< Serializza gli aggiornamenti della replica.
+
+        replica() : current(nullptr), epoch(0), applied(std::numeric_limits<uint64_t>::max()) {
+            readers[0].store(0, std::memory_order_relaxed);
+            readers[1].store(0, std::memory_order_relaxed);
+        }
+
+        ~replica() {
+            delete current.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Pubblica un nuovo stato e libera il precedente.
+         *
+         * Va chiamata con update acquisito e fuori da una sezione di lettura.
+         * Dopo lo scambio del puntatore i lettori che potevano vedere il
+         * vecchio stato sono tutti in uno dei due contatori: si dirottano i
+         * nuovi lettori sull'altro e si attende che ciascuno dei due si svuoti.
+         *
+         * @param s Stato da pubblicare (la replica ne diventa proprietaria).
+         */
+        void publish(const state* s) {
+            const state* old = current.exchange(s);
+            if (!old) {
+                return;
+            }
+            for (int flip = 0; flip < 2; ++flip) {
+                unsigned draining = epoch.fetch_add(1) & 1;
+                while (readers[draining].load(std::memory_order_acquire) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+            delete old;
+        }
+    };
+
+    /**
+     * @brief Sezione di lettura: lo stato restituito da get() resta valido fino alla sua distruzione.
+     */
+    class read_section {
+    private:
+        replica& r; ///< Replica letta.
+        unsigned slot; ///< Contatore incrementato all'ingresso.
+
+    public:
+        explicit read_section(replica& owner) : r(owner), slot(owner.epoch.load() & 1) {
+            r.readers[slot].fetch_add(1);
+        }
+
+        ~read_section() {
+            r.readers[slot].fetch_sub(1, std::memory_order_release);
+        }
+
+        read_section(const read_section&) = delete;
+        read_section& operator=(const read_section&) = delete;
+
+        const state* get() const {
+            return r.current.load();
+        }
+    };
+
+    Tree tree; ///< Albero principale, modificato solo dalle scritture.
+    std::vector<T> log; ///< Inserimenti dalla posizione log_base in poi.
+    uint64_t log_base; ///< Posizione del primo elemento di log.
+    std::atomic<uint64_t> seq; ///< Posizione della fine del log.
+    std::atomic<size_t> count; ///< Numero di elementi.
+    mutable std::mutex write_lock; ///< Protegge tree, log e log_base.
+    std::unique_ptr<replica[]> replicas; ///< Repliche.
+    unsigned replica_total; ///< Numero di repliche.
+    unsigned cores_per_replica; ///< Core che condividono una replica.
+    Compare compare; ///< Functore per confrontare i dati.
+    Equal equal; ///< Functore per verificare l'uguaglianza tra i dati.
+
+    /**
+     * @brief Replica del thread corrente, scelta in base al core su cui gira.
+     */
+    replica& current_replica() const {
+#ifdef __linux__
+        int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return replicas[(static_cast<unsigned>(cpu) / cores_per_replica) % replica_total];
+        }
+#endif
+        return replicas[std::hash<std::thread::id>()(std::this_thread::get_id()) % replica_total];
+    }
+
+    /**
+     * @brief Porta una replica alla fine del log e ne pubblica il nuovo stato.
+     *
+     * Va chiamata con r.update acquisito. Una replica mai letta, o rimasta
+     * indietro oltre la parte di log conservata, viene ricostruita copiando
+     * l'albero principale.
+     *
+     * @param r Replica da aggiornare.
+     * @return const state* Stato pubblicato, valido finché r.update resta acquisito.
+     */
+    const state* catch_up(replica& r) const {
+        const state* s = r.current.load(std::memory_order_relaxed);
+        if (s && s->seq == seq.load(std::memory_order_acquire)) {
+            return s;
+        }
+        std::unique_ptr<state> next(new state());
+        std::vector<T> fresh;
+        {
+            std::lock_guard<std::mutex> wguard(write_lock);
+            next->seq = seq.load(std::memory_order_relaxed);
+            if (!s || s->seq < log_base) {
+                next->base = std::make_shared<const Frozen>(tree, compare, equal);
+            } else {
+                fresh.assign(log.begin() + static_cast<ptrdiff_t>(s->seq - log_base), log.end());
+            }
+        }
+        if (!next->base) {
+            std::sort(fresh.begin(), fresh.end(), compare);
+            next->delta.reserve(s->delta.size() + fresh.size());
+            std::merge(s->delta.begin(), s->delta.end(), fresh.begin(), fresh.end(), std::back_inserter(next->delta), compare);
+            if (next->delta.size() > s->base->size() / delta_divisor) {
+                std::vector<T> merged;
+                merged.reserve(s->base->size() + next->delta.size());
+                std::merge(s->base->begin(), s->base->end(), next->delta.begin(), next->delta.end(),
+                           std::back_inserter(merged), compare);
+                next->base = std::make_shared<const Frozen>(std::move(merged), compare, equal);
+                next->delta.clear();
+            } else {
+                next->base = s->base;
+            }
+        }
+        s = next.release();
+        r.publish(s);
+        r.applied.store(s->seq, std::memory_order_release);
+        return s;
+    }
+
+    /**
+     * @brief Numero massimo di elementi del log oltre quelli applicati da tutte le repliche.
+     *
+     * Raggiungerlo costa a una replica in ritardo al più quanto una fusione
+     * del delta; oltre, la copia completa dell'albero non è più cara.
+     */
+    size_t log_limit() const {
+        return std::max(tree.size() / delta_divisor, static_cast<size_t>(2 * delta_divisor));
+    }
+
+    /**
+     * @brief Scarta la parte del log già applicata da tutte le repliche, o eccedente log_limit().
+     *
+     * Va chiamata con write_lock acquisito.
+     */
+    void prune_log() {
+        uint64_t end = seq.load(std::memory_order_relaxed);
+        uint64_t oldest = end;
+        for (unsigned i = 0; i < replica_total; ++i) {
+            // Una replica già rimasta indietro oltre log_base non trattiene nulla.
+            oldest = std::min(oldest, std::max(log_base, replicas[i].applied.load(std::memory_order_acquire)));
+        }
+        uint64_t limit = log_limit();
+        if (end - oldest > limit) {
+            // Le repliche più indietro verranno ricostruite alla prossima lettura.
+            oldest = end - limit;
+        }
+        size_t drop = static_cast<size_t>(oldest - log_base);
+        if (drop > log.size() / 2) {
+            log.erase(log.begin(), log.begin() + static_cast<ptrdiff_t>(drop));
+            log_base = oldest;
+        }
+    }
+
+    /**
+     * @brief Inizializza le repliche.
+     */
+    void init_replicas(unsigned replica_count) {
+        if (cores_per_replica == 0) {
+            cores_per_replica = 1;
+        }
+        if (replica_count == 0) {
+            unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            replica_count = (cores + cores_per_replica - 1) / cores_per_replica;
+        }
+        replica_total = replica_count;
+        replicas.reset(new replica[replica_total]);
+    }
+
+public:
+    /**
+     * @brief Costruisce un insieme vuoto.
+     *
+     * @param replica_count Numero di repliche (0 = una per gruppo di cores_per_replica core).
+     * @param cores Core che condividono una replica.
+     * @param comp Functore per confrontare due oggetti di tipo T.
+     * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+     */
+    explicit ReplicatedBinaryTree(unsigned replica_count = 0, unsigned cores = default_cores_per_replica,
+                                  Compare comp = Compare(), Equal eq = Equal())
+        : tree(comp, eq), log_base(0), seq(0), count(0), replica_total(0), cores_per_replica(cores),
+          compare(comp), equal(eq) {
+        init_replicas(replica_count);
+    }
+
+    /**
+     * @brief Costruisce un insieme con gli elementi di un albero.
+     *
+     * @param source Albero da copiare.
+     * @param replica_count Numero di repliche (0 = una per gruppo di cores_per_replica core).
+     * @param cores Core che condividono una replica.
+     * @throw std::bad_alloc Se la copia dell'albero fallisce.
+     */
+    explicit ReplicatedBinaryTree(const Tree& source, unsigned replica_count = 0, unsigned cores = default_cores_per_replica)
+        : tree(source), log_base(0), seq(0), count(source.size()), replica_total(0), cores_per_replica(cores),
+          compare(Compare()), equal(Equal()) {
+        init_replicas(replica_count);
+    }
+
+    ReplicatedBinaryTree(const ReplicatedBinaryTree&) = delete;
+    ReplicatedBinaryTree& operator=(const ReplicatedBinaryTree&) = delete;
+
+    /**
+     * @brief Inserisce un valore riportando l'esito con un codice.
+     *
+     * @param value Valore da inserire.
+     * @return TreeError TreeError::none, duplicate oppure out_of_memory.
+     */
+    TreeError try_insert(const T& value) {
+        std::lock_guard<std::mutex> guard(write_lock);
+        if (log.size() == log.capacity()) {
+            // Lo spazio nel log viene riservato prima di modificare l'albero.
+            log.reserve(2 * log.size() + delta_divisor);
+        }
+        TreeError err = tree.try_insert(value);
+        if (err != TreeError::none) {
+            return err;
+        }
+        log.push_back(value);
+        count.store(tree.size(), std::memory_order_relaxed);
+        seq.store(log_base + log.size(), std::memory_order_release);
+        if (log.size() >= 2 * delta_divisor && (log.size() & (log.size() - 1)) == 0) {
+            prune_log();
+        }
+        return TreeError::none;
+    }
+
+    /**
+     * @brief Inserisce un valore.
+     *
+     * @param value Valore da inserire.
+     * @throw std::runtime_error Se il valore è già presente.
+     */
+    void insert(const T& value) {
+        TreeError err = try_insert(value);
+        if (err != TreeError::none) {
+            binarytree_detail::raise(err);
+        }
+    }
+
+    /**
+     * @brief Verifica la presenza di un valore leggendo la replica del core corrente.
+     *
+     * @param value Valore da cercare.
+     * @return true Se il valore è presente.
+     * @return false Altrimenti.
+     */
+    bool exists(const T& value) const {
+        replica& r = current_replica();
+        uint64_t start = seq.load(std::memory_order_acquire);
+        for (;;) {
+            {
+                read_section section(r);
+                const state* s = section.get();
+                if (s && s->seq >= start) {
+                    return s->base->exists(value) || std::binary_search(s->delta.begin(), s->delta.end(), value, compare);
+                }
+            }
+            std::lock_guard<std::mutex> guard(r.update);
+            catch_up(r);
+        }
+    }
+
+    /**
+     * @brief Restituisce un'istantanea completa e immutabile della replica del core corrente.
+     *
+     * Il delta viene fuso prima di restituire l'istantanea, che resta valida
+     * (e invariata) anche mentre proseguono le scritture.
+     *
+     * @return std::shared_ptr<const Frozen> Istantanea con tutti gli elementi.
+     */
+    std::shared_ptr<const Frozen> snapshot() const {
+        replica& r = current_replica();
+        uint64_t start = seq.load(std::memory_order_acquire);
+        {
+            read_section section(r);
+            const state* s = section.get();
+            if (s && s->seq >= start && s->delta.empty()) {
+                return s->base;
+            }
+        }
+        std::lock_guard<std::mutex> guard(r.update);
+        const state* s = catch_up(r);
+        if (!s->delta.empty()) {
+            std::unique_ptr<state> next(new state());
+            std::vector<T> merged;
+            merged.reserve(s->base->size() + s->delta.size());
+            std::merge(s->base->begin(), s->base->end(), s->delta.begin(), s->delta.end(),
+                       std::back_inserter(merged), compare);
+            next->base = std::make_shared<const Frozen>(std::move(merged), compare, equal);
+            next->seq = s->seq;
+            s = next.release();
+            r.publish(s);
+        }
+        return s->base;
+    }
+
+    /**
+     * @brief Restituisce il numero di elementi.
+     */
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Restituisce il numero di repliche.
+     */
+    unsigned replica_count() const {
+        return replica_total;
+    }
+};
+
+#endif // REPLICATED_TREE_HPP
@@ -0,0 +1,258 @@
+#ifndef TEST_TYPES_HPP
+#define TEST_TYPES_HPP
+
+/**
+ * @file test_types.hpp
+ * @brief Tipi e functori usati dai test e dai benchmark dell'albero binario.
+ */
+
+#include <iostream>
+#include <string>
+
+// Tipo custom per test
+struct CustomType {
+    int id; ///< Identificatore univoco.
+    std::string name; ///< Nome associato all'identificatore.
+
+    /**
+     * @brief Operatore di confronto '<' per il tipo CustomType.
+     * 
+     * @param other Altro oggetto CustomType da confrontare.
+     * @return true Se l'oggetto corrente è minore di 'other'.
+     * @return false Altrimenti.
+     */
+    bool operator<(const CustomType& other) const {
+        return id < other.id;
+    }
+
+    /**
+     * @brief Operatore di confronto '==' per il tipo CustomType.
+     * 
+     * @param other Altro oggetto CustomType da confrontare.
+     * @return true Se l'oggetto corrente è uguale a 'other'.
+     * @return false Altrimenti.
+     */
+    bool operator==(const CustomType& other) const {
+        return id == other.id;
+    }
+
+    /**
+     * @brief Operatore di stream '<<' per il tipo CustomType.
+     * 
+     * @param os Stream di output su cui stampare.
+     * @param obj Oggetto CustomType da stampare.
+     * @return std::ostream& Stream di output aggiornato.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const CustomType& obj) {
+        os << "{" << obj.id << ", " << obj.name << "}";
+        return os;
+    }
+};
+
+// Functor di comparazione per il tipo int
+struct IntCompare {
+    /**
+     * @brief Operatore di confronto per il tipo int.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è minore di rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const int& lhs, const int& rhs) const {
+        return lhs < rhs;
+    }
+};
+
+// Functor di uguaglianza per il tipo int
+struct IntEqual {
+    /**
+     * @brief Operatore di uguaglianza per il tipo int.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è uguale a rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const int& lhs, const int& rhs) const {
+        return lhs == rhs;
+    }
+};
+
+// Functor per verificare se un valore è pari
+template<typename T>
+struct IsEven {
+    /**
+     * @brief Operatore di verifica per valore pari.
+     * 
+     * @param value Valore da verificare.
+     * @return true Se il valore è pari.
+     * @return false Altrimenti.
+     */
+    bool operator()(const T& value) const {
+        return value % 2 == 0;
+    }
+};
+
+// Functor di comparazione per il tipo double
+struct DoubleCompare {
+    /**
+     * @brief Operatore di confronto per il tipo double.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è minore di rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const double& lhs, const double& rhs) const {
+        return lhs < rhs;
+    }
+};
+
+// Functor di uguaglianza per il tipo double
+struct DoubleEqual {
+    /**
+     * @brief Operatore di uguaglianza per il tipo double.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è uguale a rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const double& lhs, const double& rhs) const {
+        return lhs == rhs;
+    }
+};
+
+// Functor di comparazione per il tipo string
+struct StringCompare {
+    /**
+     * @brief Operatore di confronto per il tipo string.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è minore di rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const std::string& lhs, const std::string& rhs) const {
+        return lhs < rhs;
+    }
+};
+
+// Functor di uguaglianza per il tipo string
+struct StringEqual {
+    /**
+     * @brief Operatore di uguaglianza per il tipo string.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è uguale a rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const std::string& lhs, const std::string& rhs) const {
+        return lhs == rhs;
+    }
+};
+
+// Functor di comparazione per il tipo CustomType
+struct CustomTypeCompare {
+    /**
+     * @brief Operatore di confronto per il tipo CustomType.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è minore di rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const CustomType& lhs, const CustomType& rhs) const {
+        return lhs.id < rhs.id;
+    }
+};
+
+// Functor di uguaglianza per il tipo CustomType
+struct CustomTypeEqual {
+    /**
+     * @brief Operatore di uguaglianza per il tipo CustomType.
+     * 
+     * @param lhs Primo operando.
+     * @param rhs Secondo operando.
+     * @return true Se lhs è uguale a rhs.
+     * @return false Altrimenti.
+     */
+    bool operator()(const CustomType& lhs, const CustomType& rhs) const {
+        return lhs.id == rhs.id;
+    }
+};
+
+// Functor che estrae l'id di un CustomType
+struct CustomTypeId {
+    /**
+     * @brief Restituisce l'id.
+     * 
+     * @param ct Elemento di cui estrarre l'id.
+     * @return int Id dell'elemento.
+     */
+    int operator()(const CustomType& ct) const {
+        return ct.id;
+    }
+};
+
+// Functor che estrae il nome di un CustomType
+struct CustomTypeName {
+    /**
+     * @brief Restituisce il nome.
+     * 
+     * @param ct Elemento di cui estrarre il nome.
+     * @return const std::string& Nome dell'elemento.
+     */
+    const std::string& operator()(const CustomType& ct) const {
+        return ct.name;
+    }
+};
+
+// Record con coordinate per il test dell'albero k-d
+struct Reading {
+    int id; ///< Identificatore del record.
+    double x; ///< Prima coordinata.
+    double y; ///< Seconda coordinata.
+
+    /**
+     * @brief Operatore di stream '<<' per il tipo Reading.
+     * 
+     * @param os Stream di output su cui stampare.
+     * @param obj Oggetto Reading da stampare.
+     * @return std::ostream& Stream di output aggiornato.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const Reading& obj) {
+        os << "{" << obj.id << ", (" << obj.x << ", " << obj.y << ")}";
+        return os;
+    }
+};
+
+// Functor che estrae la coordinata x di un Reading
+struct ReadingX {
+    /**
+     * @brief Restituisce la coordinata x.
+     * 
+     * @param r Record di cui estrarre la coordinata.
+     * @return double Coordinata x.
+     */
+    double operator()(const Reading& r) const {
+        return r.x;
+    }
+};
+
+// Functor che estrae la coordinata y di un Reading
+struct ReadingY {
+    /**
+     * @brief Restituisce la coordinata y.
+     * 
+     * @param r Record di cui estrarre la coordinata.
+     * @return double Coordinata y.
+     */
+    double operator()(const Reading& r) const {
+        return r.y;
+    }
+};
+
+#endif // TEST_TYPES_HPP
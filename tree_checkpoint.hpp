@@ -0,0 +1,385 @@
+#ifndef TREE_CHECKPOINT_HPP
+#define TREE_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+/**
+ * @file tree_checkpoint.hpp
+ * @brief Formato su disco dei checkpoint incrementali di BinaryTree.
+ *
+ * Un checkpoint è una directory con un file MANIFEST e una catena di
+ * segmenti seg-<numero>.bin. Ogni segmento contiene record di nodo a
+ * dimensione fissa: chiave, spostamento in sospeso (solo per chiavi
+ * aritmetiche) e i riferimenti ai due figli. Un riferimento indica numero
+ * del segmento e posizione del record, più lo spostamento ricevuto dal
+ * figlio dopo la scrittura del suo record; 0 indica un figlio assente.
+ *
+ * Un checkpoint riscrive solo i nodi modificati e i loro antenati: i
+ * record dei sottoalberi invariati restano nei segmenti precedenti e
+ * vengono referenziati dai nuovi record. Il MANIFEST (radice, numero di
+ * elementi e segmenti della catena) viene sostituito atomicamente con una
+ * rename, quindi un checkpoint interrotto lascia valido il precedente.
+ *
+ * BinaryTree include questo header e ne espone checkpoint e
+ * restore_checkpoint solo se BINARYTREE_CHECKPOINTS è definita prima di
+ * includere binarytree.hpp (i nodi portano allora i campi di tracciamento).
+ */
+
+namespace binarytree_checkpoint {
+
+static const char manifest_magic[8] = {'B', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+static const char segment_magic[8] = {'B', 'T', 'S', 'E', 'G', 'M', '0', '1'};
+
+static const unsigned index_bits = 40; ///< Bit del riferimento riservati alla posizione del record.
+static const uint64_t max_segment = (uint64_t(1) << (64 - index_bits)) - 1; ///< Ultimo numero di segmento rappresentabile.
+static const uint64_t max_records = (uint64_t(1) << index_bits) - 1; ///< Record massimi per segmento.
+
+/**
+ * @brief Codifica il riferimento a un record (mai 0).
+ *
+ * @param segment Numero del segmento (da 1).
+ * @param index Posizione del record nel segmento (da 0).
+ * @return uint64_t Riferimento al record.
+ */
+inline uint64_t make_ref(uint64_t segment, uint64_t index) {
+    return (segment << index_bits) | (index + 1);
+}
+
+/**
+ * @brief Numero del segmento di un riferimento.
+ */
+inline uint64_t ref_segment(uint64_t ref) {
+    return ref >> index_bits;
+}
+
+/**
+ * @brief Posizione del record di un riferimento nel suo segmento.
+ */
+inline uint64_t ref_index(uint64_t ref) {
+    return (ref & max_records) - 1;
+}
+
+/**
+ * @brief Segmento della catena di un checkpoint.
+ */
+struct segment_info {
+    uint64_t seq; ///< Numero del segmento (il checkpoint che lo ha scritto).
+    uint64_t records; ///< Record contenuti.
+};
+
+/**
+ * @brief Contenuto del file MANIFEST.
+ */
+struct manifest {
+    uint32_t elem_size = 0; ///< sizeof della chiave.
+    uint32_t record_size = 0; ///< Byte di un record di nodo.
+    uint64_t seq = 0; ///< Numero dell'ultimo checkpoint scritto.
+    uint64_t count = 0; ///< Elementi dell'albero.
+    std::vector<unsigned char> root; ///< Riferimento codificato alla radice.
+    std::vector<segment_info> segments; ///< Segmenti referenziati, dal più vecchio.
+};
+
+/**
+ * @brief Accoda a un buffer la rappresentazione in byte di un valore.
+ */
+template<typename V>
+void put(std::vector<unsigned char>& buffer, const V& value) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(V));
+}
+
+/**
+ * @brief Legge un valore da un buffer e avanza il puntatore.
+ */
+template<typename V>
+V get(const unsigned char*& pos) {
+    V value;
+    std::memcpy(&value, pos, sizeof(V));
+    pos += sizeof(V);
+    return value;
+}
+
+/**
+ * @brief Percorso del file di un segmento.
+ */
+inline std::string segment_path(const std::string& dir, uint64_t seq) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "seg-%08llu.bin", static_cast<unsigned long long>(seq));
+    return dir + "/" + name;
+}
+
+/**
+ * @brief Percorso del file MANIFEST.
+ */
+inline std::string manifest_path(const std::string& dir) {
+    return dir + "/MANIFEST";
+}
+
+/**
+ * @brief Scrive un file e lo forza su disco prima di chiuderlo.
+ *
+ * @param path Percorso del file (sovrascritto).
+ * @param bytes Contenuto del file.
+ * @return true Se scrittura, sincronizzazione e chiusura riescono.
+ */
+inline bool write_file(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Legge un intero file.
+ *
+ * @param path Percorso del file.
+ * @param bytes Contenuto letto.
+ * @return true Se il file esiste ed è stato letto per intero.
+ */
+inline bool read_file(const std::string& path, std::vector<unsigned char>& bytes) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bytes.resize(size);
+    bool ok = std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    std::fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Scrittura in streaming di un segmento.
+ *
+ * I record vengono accumulati in un buffer e scritti a blocchi, così un
+ * checkpoint completo di un albero grande non ne duplica la memoria.
+ */
+class segment_writer {
+private:
+    static const size_t flush_bytes = size_t(1) << 20; ///< Dimensione del buffer prima di una scrittura.
+
+    std::string path; ///< Percorso del segmento.
+    std::FILE* file; ///< File aperto (nullptr dopo un errore o la chiusura).
+    std::vector<unsigned char> buffer; ///< Byte non ancora scritti.
+    uint64_t count; ///< Record accodati.
+    bool ok; ///< Falso dopo il primo errore.
+
+    void flush() {
+        if (ok && !buffer.empty()) {
+            ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        }
+        buffer.clear();
+    }
+
+public:
+    /**
+     * @brief Crea il file del segmento e ne scrive l'intestazione.
+     *
+     * @param dir Directory del checkpoint.
+     * @param seq Numero del segmento.
+     * @param record_size Byte di un record.
+     */
+    segment_writer(const std::string& dir, uint64_t seq, uint32_t record_size)
+        : path(segment_path(dir, seq)), file(std::fopen(path.c_str(), "wb")), count(0), ok(file != nullptr) {
+        buffer.reserve(flush_bytes);
+        buffer.insert(buffer.end(), segment_magic, segment_magic + sizeof(segment_magic));
+        put(buffer, record_size);
+        put(buffer, seq);
+    }
+
+    segment_writer(const segment_writer&) = delete;
+    segment_writer& operator=(const segment_writer&) = delete;
+
+    /**
+     * @brief Chiude il file; se finish non è riuscita il segmento viene rimosso.
+     */
+    ~segment_writer() {
+        if (file) {
+            std::fclose(file);
+            ok = false;
+        }
+        if (!ok) {
+            std::remove(path.c_str());
+        }
+    }
+
+    /**
+     * @brief Buffer a cui il chiamante accoda i byte del prossimo record.
+     */
+    std::vector<unsigned char>& record() {
+        return buffer;
+    }
+
+    /**
+     * @brief Chiude il record accodato e restituisce la sua posizione nel segmento.
+     */
+    uint64_t commit() {
+        if (buffer.size() >= flush_bytes) {
+            flush();
+        }
+        return count++;
+    }
+
+    /**
+     * @brief Restituisce il numero di record scritti.
+     */
+    uint64_t records() const {
+        return count;
+    }
+
+    /**
+     * @brief Scrive i byte rimasti e forza il segmento su disco.
+     *
+     * @return true Se tutte le scritture sono riuscite.
+     */
+    bool finish() {
+        if (!file) {
+            return false;
+        }
+        flush();
+        ok = ok && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+        ok = ok && fsync(fileno(file)) == 0;
+#endif
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+};
+
+/**
+ * @brief Legge un segmento della catena e ne verifica intestazione e lunghezza.
+ *
+ * @param dir Directory del checkpoint.
+ * @param info Segmento da leggere, come riportato dal MANIFEST.
+ * @param record_size Byte di un record.
+ * @param records Record letti, senza intestazione.
+ * @return true Se il segmento è integro.
+ */
+inline bool read_segment(const std::string& dir, const segment_info& info, uint32_t record_size, std::vector<unsigned char>& records) {
+    std::vector<unsigned char> bytes;
+    const size_t header = sizeof(segment_magic) + sizeof(uint32_t) + sizeof(uint64_t);
+    if (!read_file(segment_path(dir, info.seq), bytes) || bytes.size() < header ||
+        std::memcmp(bytes.data(), segment_magic, sizeof(segment_magic)) != 0) {
+        return false;
+    }
+    const unsigned char* pos = bytes.data() + sizeof(segment_magic);
+    uint32_t size = get<uint32_t>(pos);
+    uint64_t seq = get<uint64_t>(pos);
+    if (size != record_size || seq != info.seq || bytes.size() - header != info.records * record_size) {
+        return false;
+    }
+    records.assign(bytes.begin() + header, bytes.end());
+    return true;
+}
+
+/**
+ * @brief Sostituisce atomicamente il MANIFEST di un checkpoint.
+ *
+ * Il contenuto viene scritto e sincronizzato in MANIFEST.tmp, poi rinominato.
+ *
+ * @param dir Directory del checkpoint.
+ * @param m Contenuto da scrivere.
+ * @return true Se il nuovo MANIFEST è al suo posto.
+ */
+inline bool write_manifest(const std::string& dir, const manifest& m) {
+    std::vector<unsigned char> bytes(manifest_magic, manifest_magic + sizeof(manifest_magic));
+    put(bytes, m.elem_size);
+    put(bytes, m.record_size);
+    put(bytes, m.seq);
+    put(bytes, m.count);
+    put(bytes, static_cast<uint32_t>(m.root.size()));
+    bytes.insert(bytes.end(), m.root.begin(), m.root.end());
+    put(bytes, static_cast<uint64_t>(m.segments.size()));
+    for (size_t i = 0; i < m.segments.size(); ++i) {
+        put(bytes, m.segments[i].seq);
+        put(bytes, m.segments[i].records);
+    }
+    std::string tmp = manifest_path(dir) + ".tmp";
+    if (!write_file(tmp, bytes)) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, manifest_path(dir), ec);
+    return !ec;
+}
+
+/**
+ * @brief Legge il MANIFEST di un checkpoint.
+ *
+ * @param dir Directory del checkpoint.
+ * @param m Contenuto letto.
+ * @return true Se il file esiste ed è integro.
+ */
+inline bool read_manifest(const std::string& dir, manifest& m) {
+    std::vector<unsigned char> bytes;
+    const size_t fixed = sizeof(manifest_magic) + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    if (!read_file(manifest_path(dir), bytes) || bytes.size() < fixed ||
+        std::memcmp(bytes.data(), manifest_magic, sizeof(manifest_magic)) != 0) {
+        return false;
+    }
+    const unsigned char* pos = bytes.data() + sizeof(manifest_magic);
+    const unsigned char* end = bytes.data() + bytes.size();
+    m.elem_size = get<uint32_t>(pos);
+    m.record_size = get<uint32_t>(pos);
+    m.seq = get<uint64_t>(pos);
+    m.count = get<uint64_t>(pos);
+    uint32_t root_size = get<uint32_t>(pos);
+    if (static_cast<size_t>(end - pos) < root_size + sizeof(uint64_t)) {
+        return false;
+    }
+    m.root.assign(pos, pos + root_size);
+    pos += root_size;
+    uint64_t segments = get<uint64_t>(pos);
+    if (static_cast<uint64_t>(end - pos) != segments * 2 * sizeof(uint64_t)) {
+        return false;
+    }
+    m.segments.resize(segments);
+    for (size_t i = 0; i < m.segments.size(); ++i) {
+        m.segments[i].seq = get<uint64_t>(pos);
+        m.segments[i].records = get<uint64_t>(pos);
+    }
+    return true;
+}
+
+/**
+ * @brief Rimuove i segmenti non più referenziati da una catena (senza segnalare errori).
+ *
+ * @param dir Directory del checkpoint.
+ * @param old Catena precedente.
+ * @param current Catena referenziata dal MANIFEST corrente.
+ */
+inline void remove_segments(const std::string& dir, const std::vector<segment_info>& old, const std::vector<segment_info>& current) {
+    for (size_t i = 0; i < old.size(); ++i) {
+        bool live = false;
+        for (size_t j = 0; j < current.size() && !live; ++j) {
+            live = current[j].seq == old[i].seq;
+        }
+        if (!live) {
+            std::remove(segment_path(dir, old[i].seq).c_str());
+        }
+    }
+}
+
+} // namespace binarytree_checkpoint
+
+#endif // TREE_CHECKPOINT_HPP
@@ -0,0 +1,141 @@
+#ifndef TREE_SNAPSHOT_HPP
+#define TREE_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "binarytree.hpp"
+
+/**
+ * @file tree_snapshot.hpp
+ * @brief Salvataggio e caricamento di istantanee binarie di un BinaryTree.
+ *
+ * Il formato è: 8 byte di magic "BTSNAP01", la dimensione in byte di T
+ * (uint32_t), il numero di elementi (uint64_t) e infine gli elementi in ordine
+ * crescente. È pensato per tipi banalmente copiabili (int, double, ...).
+ */
+
+namespace tree_snapshot_detail {
+    static const char magic[8] = {'B', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+    static const size_t header_size = sizeof(magic) + sizeof(uint32_t) + sizeof(uint64_t); ///< Byte prima degli elementi.
+}
+
+/**
+ * @brief Variante di save_snapshot che riporta gli errori con un codice.
+ *
+ * @tparam T Tipo dei dati contenuti nell'albero (banalmente copiabile).
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @param tree Albero da salvare.
+ * @param path Percorso del file da scrivere.
+ * @return TreeError TreeError::none oppure io_error se il file non può essere scritto.
+ */
+template <typename T, typename Compare, typename Equal>
+TreeError try_save_snapshot(const BinaryTree<T, Compare, Equal>& tree, const std::string& path) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots require a trivially copyable type.");
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return TreeError::io_error;
+    }
+    uint32_t elem_size = sizeof(T);
+    uint64_t count = tree.size();
+    out.write(tree_snapshot_detail::magic, sizeof(tree_snapshot_detail::magic));
+    out.write(reinterpret_cast<const char*>(&elem_size), sizeof(elem_size));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (typename BinaryTree<T, Compare, Equal>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+        const T& value = *it;
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    out.flush();
+    return out ? TreeError::none : TreeError::io_error;
+}
+
+/**
+ * @brief Salva gli elementi dell'albero, in ordine, in un file di istantanea.
+ *
+ * @tparam T Tipo dei dati contenuti nell'albero (banalmente copiabile).
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @param tree Albero da salvare.
+ * @param path Percorso del file da scrivere.
+ * @throw std::runtime_error Se il file non può essere scritto.
+ */
+template <typename T, typename Compare, typename Equal>
+void save_snapshot(const BinaryTree<T, Compare, Equal>& tree, const std::string& path) {
+    TreeError err = try_save_snapshot(tree, path);
+    if (err != TreeError::none) {
+        binarytree_detail::raise(err);
+    }
+}
+
+/**
+ * @brief Variante di load_snapshot che riporta gli errori con un codice.
+ *
+ * Il numero di elementi dichiarato nell'intestazione viene confrontato con
+ * la dimensione del file prima di allocare, così un'intestazione danneggiata
+ * non può richiedere più memoria di quanta ne occupi il file.
+ *
+ * @tparam T Tipo dei dati contenuti nell'albero (banalmente copiabile).
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @param path Percorso del file da leggere.
+ * @param comp Functore per confrontare due oggetti di tipo T.
+ * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @return TreeResult<BinaryTree<T, Compare, Equal>> Albero bilanciato, oppure
+ *         TreeError::io_error (file mancante, troncato o non di T) o out_of_memory.
+ */
+template <typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
+TreeResult<BinaryTree<T, Compare, Equal> > try_load_snapshot(const std::string& path, Compare comp = Compare(), Equal eq = Equal()) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots require a trivially copyable type.");
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!in) {
+        return TreeError::io_error;
+    }
+    std::streamoff file_size = in.tellg();
+    in.seekg(0);
+    char header[sizeof(tree_snapshot_detail::magic)];
+    uint32_t elem_size = 0;
+    uint64_t count = 0;
+    in.read(header, sizeof(header));
+    in.read(reinterpret_cast<char*>(&elem_size), sizeof(elem_size));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || file_size < static_cast<std::streamoff>(tree_snapshot_detail::header_size) ||
+        std::memcmp(header, tree_snapshot_detail::magic, sizeof(header)) != 0 || elem_size != sizeof(T)) {
+        return TreeError::io_error;
+    }
+    uint64_t payload = static_cast<uint64_t>(file_size) - tree_snapshot_detail::header_size;
+    if (count > payload / sizeof(T)) {
+        return TreeError::io_error; // Troncato, o conteggio danneggiato.
+    }
+    std::vector<T> values(static_cast<size_t>(count));
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    if (!in) {
+        return TreeError::io_error;
+    }
+    return BinaryTree<T, Compare, Equal>::try_bulk_build(values.begin(), values.end(), comp, eq);
+}
+
+/**
+ * @brief Carica un'istantanea e ne costruisce un albero bilanciato.
+ *
+ * @tparam T Tipo dei dati contenuti nell'albero (banalmente copiabile).
+ * @tparam Compare Functore per confrontare due oggetti di tipo T.
+ * @tparam Equal Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @param path Percorso del file da leggere.
+ * @param comp Functore per confrontare due oggetti di tipo T.
+ * @param eq Functore per verificare l'uguaglianza tra due oggetti di tipo T.
+ * @return BinaryTree<T, Compare, Equal> Albero bilanciato con gli elementi dell'istantanea.
+ * @throw std::runtime_error Se il file manca, è troncato o non è un'istantanea di T.
+ */
+template <typename T, typename Compare = std::less<T>, typename Equal = std::equal_to<T> >
+BinaryTree<T, Compare, Equal> load_snapshot(const std::string& path, Compare comp = Compare(), Equal eq = Equal()) {
+    TreeResult<BinaryTree<T, Compare, Equal> > tree = try_load_snapshot<T>(path, comp, eq);
+    BINARYTREE_TRY {
+        return std::move(tree.value());
+    } BINARYTREE_CATCH_RETHROW
+}
+
+#endif // TREE_SNAPSHOT_HPP
@@ -0,0 +1,299 @@
+#ifndef TREE_TRACE_HPP
+#define TREE_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @file tree_trace.hpp
+ * @brief Tracciamento delle operazioni sugli alberi in formato Chrome trace.
+ *
+ * Ogni thread registra gli intervalli (nome, inizio, fine) in un proprio
+ * buffer a capacità fissa: la scrittura di un evento non prende lock e non
+ * alloca (il buffer viene preso dal registro al primo evento del thread).
+ * Quando il buffer è pieno gli eventi successivi vengono scartati e
+ * contati. Alla terminazione del thread i suoi eventi vengono copiati nel
+ * registro in un vettore della dimensione esatta e il buffer torna
+ * disponibile per il prossimo thread, così la memoria non cresce con il
+ * numero di thread creati. dump() scrive tutti gli eventi nel formato JSON di Chrome trace,
+ * apribile con Perfetto (ui.perfetto.dev) o chrome://tracing.
+ *
+ * BinaryTree registra le proprie operazioni solo se BINARYTREE_TRACE è
+ * definita prima di includere binarytree.hpp; altrimenti le macro di
+ * tracciamento non generano codice.
+ */
+
+#ifndef BINARYTREE_TRACE_CAPACITY
+#define BINARYTREE_TRACE_CAPACITY 65536 ///< Eventi per thread prima di iniziare a scartare.
+#endif
+
+namespace binarytree_trace {
+
+/**
+ * @brief Intervallo registrato.
+ */
+struct event {
+    const char* name; ///< Nome dell'operazione (stringa statica).
+    int64_t begin_ns; ///< Inizio, in nanosecondi dall'avvio del tracciamento.
+    int64_t end_ns; ///< Fine, in nanosecondi dall'avvio del tracciamento.
+};
+
+/**
+ * @brief Buffer degli eventi di un thread.
+ *
+ * Un solo scrittore (il thread proprietario) e lettori che leggono fino a
+ * count, pubblicato con semantica release dopo ogni evento completo.
+ */
+struct thread_buffer {
+    std::unique_ptr<event[]> events; ///< Eventi registrati.
+    std::atomic<size_t> count; ///< Eventi completi in events.
+    std::atomic<size_t> dropped; ///< Eventi scartati a buffer pieno.
+    unsigned tid; ///< Identificativo del thread nel trace.
+
+    explicit thread_buffer(unsigned id) : events(new event[BINARYTREE_TRACE_CAPACITY]), count(0), dropped(0), tid(id) {}
+};
+
+/**
+ * @brief Eventi di un thread terminato, restituiti al registro.
+ */
+struct retired_thread {
+    unsigned tid; ///< Identificativo del thread nel trace.
+    std::vector<event> events; ///< Eventi completi al momento della terminazione.
+    size_t dropped; ///< Eventi scartati a buffer pieno.
+};
+
+/**
+ * @brief Registro globale dei buffer dei thread.
+ */
+struct registry {
+    std::mutex lock; ///< Protegge i campi seguenti (solo registrazione, terminazione e dump).
+    std::vector<std::unique_ptr<thread_buffer> > buffers; ///< Buffer dei thread attivi.
+    std::vector<std::unique_ptr<thread_buffer> > spare; ///< Buffer vuoti di thread terminati, da riusare.
+    std::vector<retired_thread> retired; ///< Eventi dei thread terminati.
+    unsigned next_tid; ///< Prossimo identificativo di thread.
+    std::chrono::steady_clock::time_point epoch; ///< Origine dei tempi.
+
+    registry() : next_tid(1), epoch(std::chrono::steady_clock::now()) {}
+};
+
+inline registry& global_registry() {
+    static registry instance;
+    return instance;
+}
+
+/**
+ * @brief Assegna un buffer al thread corrente, riusandone uno libero se c'è.
+ */
+inline thread_buffer* acquire_buffer() {
+    registry& reg = global_registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    std::unique_ptr<thread_buffer> buffer;
+    if (reg.spare.empty()) {
+        buffer.reset(new thread_buffer(reg.next_tid));
+    } else {
+        buffer = std::move(reg.spare.back());
+        reg.spare.pop_back();
+        buffer->tid = reg.next_tid;
+    }
+    reg.next_tid++;
+    reg.buffers.push_back(std::move(buffer));
+    return reg.buffers.back().get();
+}
+
+/**
+ * @brief Restituisce al registro gli eventi di un thread che termina e ne ricicla il buffer.
+ *
+ * @param buffer Buffer del thread, che non registrerà più eventi.
+ */
+inline void release_buffer(thread_buffer* buffer) {
+    registry& reg = global_registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    size_t n = buffer->count.load(std::memory_order_relaxed);
+    size_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+    if (n || dropped) {
+        retired_thread r;
+        r.tid = buffer->tid;
+        r.events.assign(buffer->events.get(), buffer->events.get() + n);
+        r.dropped = dropped;
+        reg.retired.push_back(std::move(r));
+    }
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    for (size_t b = 0; b < reg.buffers.size(); ++b) {
+        if (reg.buffers[b].get() == buffer) {
+            reg.spare.push_back(std::move(reg.buffers[b]));
+            reg.buffers.erase(reg.buffers.begin() + b);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Buffer posseduto da un thread, rilasciato quando il thread termina.
+ */
+struct thread_slot {
+    thread_buffer* buffer; ///< Buffer assegnato al primo evento, oppure nullptr.
+
+    thread_slot() : buffer(nullptr) {}
+
+    ~thread_slot() {
+        if (buffer) {
+            release_buffer(buffer);
+        }
+    }
+
+    thread_slot(const thread_slot&) = delete;
+    thread_slot& operator=(const thread_slot&) = delete;
+};
+
+/**
+ * @brief Restituisce il buffer del thread corrente, registrandolo al primo uso.
+ */
+inline thread_buffer& local_buffer() {
+    thread_local thread_slot slot;
+    if (!slot.buffer) {
+        slot.buffer = acquire_buffer();
+    }
+    return *slot.buffer;
+}
+
+/**
+ * @brief Nanosecondi trascorsi dall'avvio del tracciamento.
+ */
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - global_registry().epoch).count();
+}
+
+/**
+ * @brief Registra un intervallo completo nel buffer del thread corrente.
+ *
+ * @param name Nome dell'operazione (deve restare valido fino al dump).
+ * @param begin_ns Inizio dell'intervallo.
+ * @param end_ns Fine dell'intervallo.
+ */
+inline void record(const char* name, int64_t begin_ns, int64_t end_ns) {
+    thread_buffer& buffer = local_buffer();
+    size_t n = buffer.count.load(std::memory_order_relaxed);
+    if (n == BINARYTREE_TRACE_CAPACITY) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    event& e = buffer.events[n];
+    e.name = name;
+    e.begin_ns = begin_ns;
+    e.end_ns = end_ns;
+    buffer.count.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Registra la durata del blocco in cui è dichiarato.
+ */
+class scope {
+private:
+    const char* name; ///< Nome dell'operazione.
+    int64_t begin_ns; ///< Istante di ingresso nel blocco.
+
+public:
+    explicit scope(const char* name) : name(name), begin_ns(now_ns()) {}
+
+    ~scope() {
+        record(name, begin_ns, now_ns());
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+};
+
+/**
+ * @brief Scrive gli eventi di un thread come voci del trace JSON.
+ *
+ * @param os Stream di output.
+ * @param first Vero finché non è stata scritta alcuna voce; aggiornato.
+ * @param tid Identificativo del thread.
+ * @param events Eventi completi.
+ * @param n Numero di eventi.
+ * @param dropped Eventi scartati a buffer pieno.
+ */
+inline void write_events(std::ostream& os, bool& first, unsigned tid, const event* events, size_t n, size_t dropped) {
+    char buf[64];
+    for (size_t i = 0; i < n; ++i) {
+        const event& e = events[i];
+        os << (first ? "\n" : ",\n") << "{\"name\":\"" << e.name << "\",\"cat\":\"binarytree\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+        std::snprintf(buf, sizeof(buf), ",\"ts\":%.3f,\"dur\":%.3f}", e.begin_ns / 1000.0, (e.end_ns - e.begin_ns) / 1000.0);
+        os << buf;
+        first = false;
+    }
+    if (dropped) {
+        os << (first ? "\n" : ",\n") << "{\"name\":\"dropped_events\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid
+           << ",\"ts\":0,\"args\":{\"dropped\":" << dropped << "}}";
+        first = false;
+    }
+}
+
+/**
+ * @brief Scrive tutti gli eventi registrati in formato Chrome trace JSON.
+ *
+ * Può essere chiamata mentre altri thread registrano: vengono scritti gli
+ * eventi dei thread terminati e quelli completi al momento della lettura di
+ * ciascun buffer attivo.
+ *
+ * @param os Stream di output.
+ */
+inline void dump(std::ostream& os) {
+    registry& reg = global_registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t r = 0; r < reg.retired.size(); ++r) {
+        const retired_thread& t = reg.retired[r];
+        write_events(os, first, t.tid, t.events.data(), t.events.size(), t.dropped);
+    }
+    for (size_t b = 0; b < reg.buffers.size(); ++b) {
+        const thread_buffer& buffer = *reg.buffers[b];
+        size_t n = buffer.count.load(std::memory_order_acquire);
+        write_events(os, first, buffer.tid, buffer.events.get(), n, buffer.dropped.load(std::memory_order_relaxed));
+    }
+    os << "\n]}\n";
+}
+
+/**
+ * @brief Scrive il trace in un file.
+ *
+ * @param path Percorso del file JSON.
+ * @return true Se il file è stato scritto.
+ * @return false Altrimenti.
+ */
+inline bool dump_file(const std::string& path) {
+    std::ofstream out(path.c_str());
+    dump(out);
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Svuota tutti i buffer e scarta gli eventi dei thread terminati.
+ *
+ * Va chiamata solo mentre nessun thread sta registrando eventi.
+ */
+inline void clear() {
+    registry& reg = global_registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    reg.retired.clear();
+    for (size_t b = 0; b < reg.buffers.size(); ++b) {
+        reg.buffers[b]->count.store(0, std::memory_order_relaxed);
+        reg.buffers[b]->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace binarytree_trace
+
+#endif // TREE_TRACE_HPP